@@ -5,12 +5,108 @@
  * Licensed under the MIT license:
  * http://www.opensource.org/licenses/mit-license.php
  *
- * Implementation of writable buffer object.
+ * Implementation of writable buffer object, of buffer views of
+ * external memory and of typed array views of numeric C arrays.
  */
 
 #include <string.h>
 #include "lua_gobject.h"
 
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Buffer view of external memory, which is kept valid by the owner
+   until the view is collected. */
+typedef struct _BufferView
+{
+  guint8 *data;
+  gsize size;
+  gboolean writable;
+  GDestroyNotify destroy;
+  gpointer owner;
+} BufferView;
+
+/* Resolves range given by arguments narg and narg + 1 (i and j,
+   1-based, negative counting from the end, as string.sub()) of
+   sequence of given length.  Returns number of elements in the
+   range and stores 0-based offset of its first element. */
+static gsize
+slice_range (lua_State *L, gsize length, int narg, gsize *offset)
+{
+  lua_Integer len = length;
+  lua_Integer i = luaL_optinteger (L, narg, 1);
+  lua_Integer j = luaL_optinteger (L, narg + 1, -1);
+  if (i < 0)
+    i = MAX (len + i + 1, 1);
+  else if (i == 0)
+    i = 1;
+  if (j < 0)
+    j = len + j + 1;
+  else if (j > len)
+    j = len;
+
+  *offset = (i <= j) ? i - 1 : 0;
+  return (i <= j) ? j - i + 1 : 0;
+}
+
+/* Makes userdata on the top of the stack keep the value at index
+   owner alive. */
+static void
+keep_alive (lua_State *L, int owner)
+{
+  lua_gobject_makeabs (L, owner);
+  lua_createtable (L, 1, 0);
+  lua_pushvalue (L, owner);
+  lua_rawseti (L, -2, 1);
+  lua_setfenv (L, -2);
+}
+
+/* Looks up method of the userdata at index 1 named by the key at
+   index 2 in its metatable. */
+static int
+push_method (lua_State *L)
+{
+  lua_getmetatable (L, 1);
+  lua_pushvalue (L, 2);
+  lua_rawget (L, -2);
+  return 1;
+}
+
+/* Pushes number of given type stored at (possibly unaligned)
+   address. */
+static void
+push_number (lua_State *L, GITypeTag tag, gconstpointer elt)
+{
+  GIArgument arg;
+  memcpy (&arg, elt, lua_gobject_array_elt_size (tag));
+  if (tag == GI_TYPE_TAG_FLOAT)
+    lua_pushnumber (L, arg.v_float);
+  else if (tag == GI_TYPE_TAG_DOUBLE)
+    lua_pushnumber (L, arg.v_double);
+  else
+    lua_gobject_marshal_2lua_int (L, tag, &arg, 0);
+}
+
+/* Stores number at narg as given type to (possibly unaligned)
+   address. */
+static void
+store_number (lua_State *L, GITypeTag tag, gpointer elt, int narg)
+{
+  GIArgument arg;
+  if (tag == GI_TYPE_TAG_FLOAT)
+    arg.v_float = (gfloat) luaL_checknumber (L, narg);
+  else if (tag == GI_TYPE_TAG_DOUBLE)
+    arg.v_double = luaL_checknumber (L, narg);
+  else
+    lua_gobject_marshal_2c_int (L, tag, &arg, narg, FALSE, 0);
+  memcpy (elt, &arg, lua_gobject_array_elt_size (tag));
+}
+
 static int
 buffer_len (lua_State *L)
 {
@@ -35,6 +131,8 @@ buffer_index (lua_State *L)
   index = lua_tointeger (L, 2);
   if (index > 0 && (size_t) index <= lua_objlen (L, 1))
     lua_pushinteger (L, buffer[index - 1]);
+  else if (lua_type (L, 2) == LUA_TSTRING)
+    return push_method (L);
   else
     {
       luaL_argcheck (L, !lua_isnoneornil (L, 2), 2, "nil index");
@@ -55,6 +153,247 @@ buffer_newindex (lua_State *L)
   return 0;
 }
 
+/* Checks that narg is buffer or buffer view, writable one if
+   requested.  Returns its data and stores its size. */
+static guint8 *
+buffer_check (lua_State *L, int narg, gsize *size, gboolean writable)
+{
+  guint8 *data = writable ? lua_gobject_buffer_test_writable (L, narg, size)
+    : lua_gobject_buffer_test (L, narg, size);
+  luaL_argcheck (L, data != NULL, narg, "expected bytes buffer");
+  return data;
+}
+
+/* Checks that narg is buffer, buffer view or string.  Returns its data
+   and stores its size. */
+static const guint8 *
+source_check (lua_State *L, int narg, gsize *size)
+{
+  const guint8 *data = lua_gobject_buffer_test (L, narg, size);
+  if (data == NULL)
+    {
+      size_t len;
+      data = (const guint8 *) luaL_checklstring (L, narg, &len);
+      *size = len;
+    }
+  return data;
+}
+
+/* Checks type name of number stored in the buffer, using the same
+   names as typed arrays (e.g. 'gint32' or 'gdouble'). */
+static GITypeTag
+check_number_type (lua_State *L, int narg)
+{
+  const gchar *name = luaL_checkstring (L, narg);
+  GITypeTag tag;
+  for (tag = GI_TYPE_TAG_INT8; tag <= GI_TYPE_TAG_DOUBLE; tag++)
+    if (g_strcmp0 (name, gi_type_tag_to_string (tag)) == 0)
+      return tag;
+  luaL_argerror (L, narg, "bad number type");
+  return GI_TYPE_TAG_VOID;
+}
+
+/* Checks byte order at narg, returns TRUE if bytes of numbers have to
+   be swapped. */
+static gboolean
+check_swap (lua_State *L, int narg)
+{
+  static const char *const orders[] = { "native", "le", "be", NULL };
+  switch (luaL_checkoption (L, narg, "native", orders))
+    {
+    case 1:
+      return G_BYTE_ORDER != G_LITTLE_ENDIAN;
+    case 2:
+      return G_BYTE_ORDER != G_BIG_ENDIAN;
+    default:
+      return FALSE;
+    }
+}
+
+/* Reverses order of bytes of a number. */
+static void
+swap_bytes (guint8 *data, gsize size)
+{
+  gsize i;
+  for (i = 0; i < size / 2; i++)
+    {
+      guint8 byte = data[i];
+      data[i] = data[size - i - 1];
+      data[size - i - 1] = byte;
+    }
+}
+
+/* Finds first occurence of needle in memory block, NULL if there is
+   none.  memchr() locates candidates for the first byte. */
+static const guint8 *
+find_bytes (const guint8 *data, gsize size, const guint8 *needle, gsize len)
+{
+  const guint8 *end;
+  if (len == 0)
+    return data;
+  if (size < len)
+    return NULL;
+
+  end = data + size - len + 1;
+  while ((data = memchr (data, needle[0], end - data)) != NULL)
+    {
+      if (memcmp (data + 1, needle + 1, len - 1) == 0)
+	return data;
+      data++;
+    }
+  return NULL;
+}
+
+/* Creates view of bytes i to j of the buffer, sharing its memory.
+   Lua prototype:
+   view = buffer:slice([i[, j]]) */
+static int
+buffer_slice (lua_State *L)
+{
+  gsize size, offset, count;
+  guint8 *data = buffer_check (L, 1, &size, FALSE);
+  BufferView *view = lua_gobject_udata_test (L, 1, LUA_GOBJECT_BYTES_VIEW);
+  count = slice_range (L, size, 2, &offset);
+  lua_gobject_buffer_view_new (L, data + offset, count,
+			       view == NULL || view->writable, NULL, NULL);
+  keep_alive (L, 1);
+  return 1;
+}
+
+/* Reads number of given type (e.g. 'guint32') at given 1-based
+   offset.  Lua prototype:
+   value = buffer:get(type, offset[, 'native'|'le'|'be']) */
+static int
+buffer_get (lua_State *L)
+{
+  gsize size, esize;
+  guint8 *data = buffer_check (L, 1, &size, FALSE);
+  GITypeTag tag = check_number_type (L, 2);
+  lua_Integer offset = luaL_checkinteger (L, 3);
+  guint8 elt[8];
+
+  esize = lua_gobject_array_elt_size (tag);
+  luaL_argcheck (L, offset > 0 && (gsize) offset - 1 + esize <= size, 3,
+		 "out of bounds");
+  memcpy (elt, data + offset - 1, esize);
+  if (check_swap (L, 4))
+    swap_bytes (elt, esize);
+  push_number (L, tag, elt);
+  return 1;
+}
+
+/* Writes number of given type at given 1-based offset.  Lua
+   prototype:
+   buffer:set(type, offset, value[, 'native'|'le'|'be']) */
+static int
+buffer_set (lua_State *L)
+{
+  gsize size, esize;
+  guint8 *data = buffer_check (L, 1, &size, TRUE);
+  GITypeTag tag = check_number_type (L, 2);
+  lua_Integer offset = luaL_checkinteger (L, 3);
+  guint8 elt[8];
+
+  esize = lua_gobject_array_elt_size (tag);
+  luaL_argcheck (L, offset > 0 && (gsize) offset - 1 + esize <= size, 3,
+		 "out of bounds");
+  store_number (L, tag, elt, 4);
+  if (check_swap (L, 5))
+    swap_bytes (elt, esize);
+  memcpy (data + offset - 1, elt, esize);
+  return 0;
+}
+
+/* Copies bytes i to j of the source (buffer, view or string) into
+   the buffer at given 1-based offset.  Source and target may
+   overlap.  Lua prototype:
+   buffer:copy(offset, source[, i[, j]]) */
+static int
+buffer_copy (lua_State *L)
+{
+  gsize size, source_size, start, count;
+  guint8 *data = buffer_check (L, 1, &size, TRUE);
+  lua_Integer offset = luaL_checkinteger (L, 2);
+  const guint8 *source = source_check (L, 3, &source_size);
+
+  count = slice_range (L, source_size, 4, &start);
+  luaL_argcheck (L, offset > 0 && (gsize) offset - 1 + count <= size, 2,
+		 "out of bounds");
+  memmove (data + offset - 1, source + start, count);
+  return 0;
+}
+
+/* Fills bytes i to j of the buffer with given byte value.  Lua
+   prototype:
+   buffer:fill(byte[, i[, j]]) */
+static int
+buffer_fill (lua_State *L)
+{
+  gsize size, start, count;
+  guint8 *data = buffer_check (L, 1, &size, TRUE);
+  int byte = luaL_checkint (L, 2);
+
+  count = slice_range (L, size, 3, &start);
+  memset (data + start, byte & 0xff, count);
+  return 0;
+}
+
+/* Searches for the needle (buffer, view or string) starting at given
+   1-based position, returns position of the first match or nil.  Lua
+   prototype:
+   pos = buffer:find(needle[, init]) */
+static int
+buffer_find (lua_State *L)
+{
+  gsize size, len, start;
+  const guint8 *data = buffer_check (L, 1, &size, FALSE), *needle, *found;
+
+  needle = source_check (L, 2, &len);
+  slice_range (L, size, 3, &start);
+  if (lua_isnoneornil (L, 3) || luaL_checkinteger (L, 3) <= (lua_Integer) size)
+    {
+      found = find_bytes (data + start, size - start, needle, len);
+      if (found != NULL)
+	{
+	  lua_pushinteger (L, found - data + 1);
+	  return 1;
+	}
+    }
+  lua_pushnil (L);
+  return 1;
+}
+
+/* Compares contents of the buffer with other buffer, view or string,
+   returns negative, zero or positive number, as memcmp().  Lua
+   prototype:
+   result = buffer:compare(other) */
+static int
+buffer_compare (lua_State *L)
+{
+  gsize size, other_size;
+  const guint8 *data = buffer_check (L, 1, &size, FALSE), *other;
+  int result;
+
+  other = source_check (L, 2, &other_size);
+  result = memcmp (data, other, MIN (size, other_size));
+  if (result == 0)
+    result = (size > other_size) - (size < other_size);
+  lua_pushinteger (L, (result > 0) - (result < 0));
+  return 1;
+}
+
+/* Methods shared by buffers and buffer views. */
+static const luaL_Reg buffer_methods_reg[] = {
+  { "slice", buffer_slice },
+  { "get", buffer_get },
+  { "set", buffer_set },
+  { "copy", buffer_copy },
+  { "fill", buffer_fill },
+  { "find", buffer_find },
+  { "compare", buffer_compare },
+  { NULL, NULL }
+};
+
 static const luaL_Reg buffer_mt_reg[] = {
   { "__len", buffer_len },
   { "__tostring", buffer_tostring },
@@ -84,8 +423,440 @@ buffer_new (lua_State *L)
   return 1;
 }
 
+#ifdef G_OS_UNIX
+/* Shared mapping of the file, owner of writable map views. */
+typedef struct _SharedMapping
+{
+  gpointer addr;
+  gsize size;
+} SharedMapping;
+
+static void
+shared_mapping_free (SharedMapping *mapping)
+{
+  munmap (mapping->addr, mapping->size);
+  g_free (mapping);
+}
+
+/* Maps file shared, so that writes to the view are stored back into
+   the file.  GMappedFile maps files privately, so it cannot be used
+   here. */
+static int
+buffer_map_shared (lua_State *L, const char *filename)
+{
+  struct stat st;
+  SharedMapping *mapping;
+  gpointer addr = NULL;
+  int fd = open (filename, O_RDWR), err;
+
+  if (fd < 0 || fstat (fd, &st) < 0)
+    goto fail;
+  if (st.st_size > 0)
+    {
+      addr = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+      if (addr == MAP_FAILED)
+	goto fail;
+    }
+
+  close (fd);
+  if (addr == NULL)
+    {
+      lua_gobject_buffer_view_new (L, NULL, 0, TRUE, NULL, NULL);
+      return 1;
+    }
+
+  mapping = g_new (SharedMapping, 1);
+  mapping->addr = addr;
+  mapping->size = st.st_size;
+  lua_gobject_buffer_view_new (L, addr, st.st_size, TRUE,
+			       (GDestroyNotify) shared_mapping_free, mapping);
+  return 1;
+
+ fail:
+  err = errno;
+  if (fd >= 0)
+    close (fd);
+  lua_pushnil (L);
+  lua_pushfstring (L, "%s: %s", filename, g_strerror (err));
+  return 2;
+}
+#endif
+
+/* Maps file into memory.  Writes to writable mapping are stored back
+   into the file; writable mappings are supported only on Unix.  Lua
+   prototype:
+   view = bytes.map(filename[, writable]) */
+static int
+buffer_map (lua_State *L)
+{
+  GError *err = NULL;
+  const char *filename = luaL_checkstring (L, 1);
+  GMappedFile *file;
+
+  if (lua_toboolean (L, 2))
+    {
+#ifdef G_OS_UNIX
+      return buffer_map_shared (L, filename);
+#else
+      return luaL_argerror (L, 2, "writable mapping not supported");
+#endif
+    }
+
+  file = g_mapped_file_new (filename, FALSE, &err);
+  if (file == NULL)
+    {
+      lua_pushnil (L);
+      lua_pushstring (L, err->message);
+      g_error_free (err);
+      return 2;
+    }
+
+  lua_gobject_buffer_view_new (L, g_mapped_file_get_contents (file),
+			       g_mapped_file_get_length (file), FALSE,
+			       (GDestroyNotify) g_mapped_file_unref, file);
+  return 1;
+}
+
+/* Creates view of memory given by raw pointer and size, optionally
+   keeping alive the owner of the memory.  Lua prototype:
+   view = bytes.view(pointer, size[, owner[, writable]]) */
+static int
+buffer_view (lua_State *L)
+{
+  gpointer data;
+  lua_Integer size;
+
+  luaL_checktype (L, 1, LUA_TLIGHTUSERDATA);
+  data = lua_touserdata (L, 1);
+  size = luaL_checkinteger (L, 2);
+  luaL_argcheck (L, size >= 0 && (data != NULL || size == 0), 2, "bad size");
+  lua_gobject_buffer_view_new (L, data, size, lua_toboolean (L, 4),
+			       NULL, NULL);
+  if (!lua_isnoneornil (L, 3))
+    keep_alive (L, 3);
+  return 1;
+}
+
 static const luaL_Reg buffer_reg[] = {
   { "new", buffer_new },
+  { "map", buffer_map },
+  { "view", buffer_view },
+  { NULL, NULL }
+};
+
+gpointer
+lua_gobject_buffer_test (lua_State *L, int narg, gsize *size)
+{
+  gpointer data = lua_gobject_udata_test (L, narg, LUA_GOBJECT_BYTES_BUFFER);
+  BufferView *view;
+  if (data != NULL)
+    {
+      if (size != NULL)
+	*size = lua_objlen (L, narg);
+      return data;
+    }
+
+  view = lua_gobject_udata_test (L, narg, LUA_GOBJECT_BYTES_VIEW);
+  if (view == NULL)
+    return NULL;
+  if (size != NULL)
+    *size = view->size;
+  return view->data;
+}
+
+gpointer
+lua_gobject_buffer_test_writable (lua_State *L, int narg, gsize *size)
+{
+  BufferView *view = lua_gobject_udata_test (L, narg, LUA_GOBJECT_BYTES_VIEW);
+  luaL_argcheck (L, view == NULL || view->writable, narg, "read-only buffer");
+  return lua_gobject_buffer_test (L, narg, size);
+}
+
+void
+lua_gobject_buffer_view_new (lua_State *L, gpointer data, gsize size,
+			     gboolean writable, GDestroyNotify destroy,
+			     gpointer owner)
+{
+  BufferView *view = lua_newuserdata (L, sizeof (BufferView));
+
+  /* Empty views still need valid address, so that they are
+     distinguishable from NULL. */
+  static guint8 empty[1];
+  view->data = (data != NULL) ? data : empty;
+  view->size = size;
+  view->writable = writable;
+  view->destroy = destroy;
+  view->owner = owner;
+  luaL_getmetatable (L, LUA_GOBJECT_BYTES_VIEW);
+  lua_setmetatable (L, -2);
+}
+
+static int
+view_len (lua_State *L)
+{
+  BufferView *view = luaL_checkudata (L, 1, LUA_GOBJECT_BYTES_VIEW);
+  lua_pushinteger (L, view->size);
+  return 1;
+}
+
+static int
+view_tostring (lua_State *L)
+{
+  BufferView *view = luaL_checkudata (L, 1, LUA_GOBJECT_BYTES_VIEW);
+  lua_pushlstring (L, (const char *) view->data, view->size);
+  return 1;
+}
+
+static int
+view_index (lua_State *L)
+{
+  lua_gobject_Unsigned index;
+  BufferView *view = luaL_checkudata (L, 1, LUA_GOBJECT_BYTES_VIEW);
+  index = lua_tointeger (L, 2);
+  if (index > 0 && (gsize) index <= view->size)
+    lua_pushinteger (L, view->data[index - 1]);
+  else if (lua_type (L, 2) == LUA_TSTRING)
+    return push_method (L);
+  else
+    {
+      luaL_argcheck (L, !lua_isnoneornil (L, 2), 2, "nil index");
+      lua_pushnil (L);
+    }
+  return 1;
+}
+
+static int
+view_newindex (lua_State *L)
+{
+  lua_gobject_Unsigned index;
+  BufferView *view = luaL_checkudata (L, 1, LUA_GOBJECT_BYTES_VIEW);
+  luaL_argcheck (L, view->writable, 1, "read-only buffer");
+  index = luaL_checkint (L, 2);
+  luaL_argcheck (L, index > 0 && (gsize) index <= view->size, 2, "bad index");
+  view->data[index - 1] = luaL_checkint (L, 3) & 0xff;
+  return 0;
+}
+
+static int
+view_gc (lua_State *L)
+{
+  BufferView *view = lua_touserdata (L, 1);
+  if (view->destroy != NULL)
+    view->destroy (view->owner);
+  view->destroy = NULL;
+  view->size = 0;
+  return 0;
+}
+
+static const luaL_Reg view_mt_reg[] = {
+  { "__len", view_len },
+  { "__tostring", view_tostring },
+  { "__index", view_index },
+  { "__newindex", view_newindex },
+  { "__gc", view_gc },
+  { NULL, NULL }
+};
+
+/* Typed array, view of C array of numeric elements.  Data is either
+   copied right after the header, owned (released by g_free()) or
+   borrowed from another array kept alive in the environment table. */
+typedef struct _TypedArray
+{
+  gpointer data;
+  gsize length;
+  GITypeTag tag;
+  gboolean owned;
+} TypedArray;
+
+/* Size of the header, keeping copied data aligned. */
+#define TYPED_ARRAY_HEADER						\
+  ((sizeof (TypedArray) + sizeof (gdouble) - 1) & ~(sizeof (gdouble) - 1))
+
+gsize
+lua_gobject_array_elt_size (GITypeTag tag)
+{
+  switch (tag)
+    {
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+      return 1;
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+      return 2;
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_FLOAT:
+      return 4;
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_DOUBLE:
+      return 8;
+    default:
+      return 0;
+    }
+}
+
+gpointer
+lua_gobject_array_new (lua_State *L, GITypeTag tag, gpointer data,
+		       gsize length, gboolean owned)
+{
+  gsize esize = lua_gobject_array_elt_size (tag);
+  TypedArray *array;
+
+  g_assert (esize != 0);
+  array = lua_newuserdata (L, TYPED_ARRAY_HEADER
+			   + (owned ? 0 : length * esize));
+  array->length = length;
+  array->tag = tag;
+  array->owned = owned;
+  if (owned)
+    array->data = data;
+  else
+    {
+      array->data = (gchar *) array + TYPED_ARRAY_HEADER;
+      if (data != NULL)
+	memcpy (array->data, data, length * esize);
+      else
+	memset (array->data, 0, length * esize);
+    }
+  luaL_getmetatable (L, LUA_GOBJECT_ARRAY);
+  lua_setmetatable (L, -2);
+  return array->data;
+}
+
+gboolean
+lua_gobject_array_test (lua_State *L, int narg, GITypeTag tag,
+			gpointer *data, gsize *length)
+{
+  TypedArray *array = lua_gobject_udata_test (L, narg, LUA_GOBJECT_ARRAY);
+  if (array == NULL || array->tag != tag)
+    return FALSE;
+
+  *data = array->data;
+  *length = array->length;
+  return TRUE;
+}
+
+/* Pushes i-th (0-based) element of the array. */
+static void
+array_push (lua_State *L, TypedArray *array, gsize i)
+{
+  gsize esize = lua_gobject_array_elt_size (array->tag);
+  push_number (L, array->tag, (gchar *) array->data + i * esize);
+}
+
+static int
+array_len (lua_State *L)
+{
+  TypedArray *array = luaL_checkudata (L, 1, LUA_GOBJECT_ARRAY);
+  lua_pushinteger (L, array->length);
+  return 1;
+}
+
+static int
+array_gc (lua_State *L)
+{
+  TypedArray *array = lua_touserdata (L, 1);
+  if (array->owned)
+    g_free (array->data);
+  array->owned = FALSE;
+  array->data = NULL;
+  array->length = 0;
+  return 0;
+}
+
+/* Converts the array to Lua table.  Lua prototype:
+   table = array:totable() */
+static int
+array_totable (lua_State *L)
+{
+  TypedArray *array = luaL_checkudata (L, 1, LUA_GOBJECT_ARRAY);
+  gsize i;
+  lua_createtable (L, array->length, 0);
+  for (i = 0; i < array->length; i++)
+    {
+      array_push (L, array, i);
+      lua_rawseti (L, -2, i + 1);
+    }
+  return 1;
+}
+
+/* Creates view of elements i to j (inclusive, 1-based, negative
+   counting from the end, as string.sub()) sharing data with the array.
+   Lua prototype:
+   view = array:slice(i[, j]) */
+static int
+array_slice (lua_State *L)
+{
+  TypedArray *array = luaL_checkudata (L, 1, LUA_GOBJECT_ARRAY), *view;
+  gsize offset;
+
+  view = lua_newuserdata (L, TYPED_ARRAY_HEADER);
+  view->tag = array->tag;
+  view->owned = FALSE;
+  view->length = slice_range (L, array->length, 2, &offset);
+  view->data = (gchar *) array->data
+    + offset * lua_gobject_array_elt_size (array->tag);
+  luaL_getmetatable (L, LUA_GOBJECT_ARRAY);
+  lua_setmetatable (L, -2);
+  keep_alive (L, 1);
+  return 1;
+}
+
+static const luaL_Reg array_methods_reg[] = {
+  { "totable", array_totable },
+  { "slice", array_slice },
+  { NULL, NULL }
+};
+
+static int
+array_index (lua_State *L)
+{
+  TypedArray *array = luaL_checkudata (L, 1, LUA_GOBJECT_ARRAY);
+  if (lua_type (L, 2) == LUA_TNUMBER)
+    {
+      lua_Integer index = lua_tointeger (L, 2);
+      if (index > 0 && (gsize) index <= array->length)
+	array_push (L, array, index - 1);
+      else
+	lua_pushnil (L);
+    }
+  else if (g_strcmp0 (lua_tostring (L, 2), "type") == 0)
+    lua_pushstring (L, gi_type_tag_to_string (array->tag));
+  else
+    return push_method (L);
+  return 1;
+}
+
+static int
+array_newindex (lua_State *L)
+{
+  TypedArray *array = luaL_checkudata (L, 1, LUA_GOBJECT_ARRAY);
+  lua_Integer index = luaL_checkinteger (L, 2);
+  gsize esize = lua_gobject_array_elt_size (array->tag);
+
+  luaL_argcheck (L, index > 0 && (gsize) index <= array->length, 2,
+		 "bad index");
+  store_number (L, array->tag, (gchar *) array->data + (index - 1) * esize, 3);
+  return 0;
+}
+
+static int
+array_tostring (lua_State *L)
+{
+  TypedArray *array = luaL_checkudata (L, 1, LUA_GOBJECT_ARRAY);
+  lua_pushfstring (L, "lua_gobject.array: %s[%d]",
+		   gi_type_tag_to_string (array->tag), (int) array->length);
+  return 1;
+}
+
+static const luaL_Reg array_mt_reg[] = {
+  { "__len", array_len },
+  { "__gc", array_gc },
+  { "__index", array_index },
+  { "__newindex", array_newindex },
+  { "__tostring", array_tostring },
   { NULL, NULL }
 };
 
@@ -95,6 +866,15 @@ lua_gobject_buffer_init (lua_State *L)
   /* Register metatables. */
   luaL_newmetatable (L, LUA_GOBJECT_BYTES_BUFFER);
   luaL_register (L, NULL, buffer_mt_reg);
+  luaL_register (L, NULL, buffer_methods_reg);
+  lua_pop (L, 1);
+  luaL_newmetatable (L, LUA_GOBJECT_BYTES_VIEW);
+  luaL_register (L, NULL, view_mt_reg);
+  luaL_register (L, NULL, buffer_methods_reg);
+  lua_pop (L, 1);
+  luaL_newmetatable (L, LUA_GOBJECT_ARRAY);
+  luaL_register (L, NULL, array_mt_reg);
+  luaL_register (L, NULL, array_methods_reg);
   lua_pop (L, 1);
 
   /* Register global API. */
@@ -26,6 +26,31 @@ typedef enum _ParamKind
     PARAM_KIND_ENUM
   } ParamKind;
 
+/* Marshalling operation precompiled for PARAM_KIND_TI parameter when
+   the callable is created, so that the call path does not have to
+   query typeinfo again. */
+typedef enum _ParamOp
+  {
+    /* Generic marshalling using lua_gobject_marshal_2c/2lua. */
+    PARAM_OP_GENERIC = 0,
+
+    /* gboolean value. */
+    PARAM_OP_BOOLEAN,
+
+    /* Integral value (including GType), Param's tag holds exact type. */
+    PARAM_OP_INT,
+
+    /* Floating point values. */
+    PARAM_OP_FLOAT,
+    PARAM_OP_DOUBLE,
+
+    /* UTF-8 string. */
+    PARAM_OP_UTF8,
+
+    /* GObject instance or interface, Param's gtype holds its type. */
+    PARAM_OP_OBJECT
+  } ParamOp;
+
 /* Represents single parameter in callable description. */
 typedef struct _Param
 {
@@ -65,8 +90,35 @@ typedef struct _Param
   /* Index into env table attached to the callable, contains repotype
      table for specified argument. */
   guint repotype_index : 4;
+
+  /* Precompiled marshalling operation, one of ParamOp values. */
+  guint op : 3;
+
+  /* Type tag of ti, if present. */
+  guint tag : 5;
+
+  /* Cached optional and may_be_null attributes of the argument. */
+  guint optional : 1;
+
+  /* Cached caller_allocates attribute of the argument. */
+  guint caller_alloc : 1;
+
+  /* GType of the argument for PARAM_OP_OBJECT. */
+  GType gtype;
 } Param;
 
+/* Kind of 'self' argument of the callable. */
+typedef enum _CallableSelf
+  {
+    CALLABLE_SELF_NONE,
+
+    /* 'self' is an object or interface instance. */
+    CALLABLE_SELF_OBJECT,
+
+    /* 'self' is a struct or union record. */
+    CALLABLE_SELF_RECORD
+  } CallableSelf;
+
 /* Structure representing userdata allocated for any callable, i.e. function,
    method, signal, vtable, callback... */
 typedef struct _Callable
@@ -87,6 +139,39 @@ typedef struct _Callable
   guint ignore_retval : 1;
   guint is_closure_marshal : 1;
 
+  /* Set when return value is something else than plain void. */
+  guint has_retval : 1;
+
+  /* Set when all arguments and return value are plain scalars, so the
+     call can use simplified marshalling in callable_call_scalar(). */
+  guint is_scalar : 1;
+
+  /* Set when the function is known not to block and not to invoke any
+     callbacks, so the state lock is kept held during the call. */
+  guint nonblocking : 1;
+
+  /* Set when notified and async closures passed to the callable
+     should be shared among calls with the same Lua target. */
+  guint intern_closures : 1;
+
+  /* Set when numeric arrays returned by the callable should be
+     marshalled as typed array views instead of Lua tables. */
+  guint array_views : 1;
+
+  /* Set when lists and hash tables returned by the callable should be
+     marshalled as lazy proxies instead of Lua tables. */
+  guint lazy_containers : 1;
+
+  /* Set when marshalling of arguments can create temporaries, which
+     are then kept in per-call arena instead of guards on the stack. */
+  guint needs_arena : 1;
+
+  /* Kind of 'self' argument, one of CallableSelf values. */
+  guint self_kind : 2;
+
+  /* GType of 'self' argument for CALLABLE_SELF_OBJECT. */
+  GType self_gtype;
+
   /* Initialized FFI CIF structure. */
   ffi_cif cif;
 
@@ -98,12 +183,16 @@ typedef struct _Callable
   /* params points here, contains Param[nargs] entries. */
 } Callable;
 
-/* Address is lightuserdata of Callable metatable in Lua registry. */
-static int callable_mt;
+/* Maximal count of C arguments (including 'self') of the callable
+   eligible for callable_call_scalar(). */
+#define CALLABLE_SCALAR_MAX_ARGS 8
+
+/* Index in env table of callables created from GI info, which caches
+   repotype table of CALLABLE_SELF_RECORD 'self' argument. */
+#define CALLABLE_ENV_SELF_REPOTYPE 0
 
-/* Lua thread that can be used for argument marshaling if needed.
- * This address is used as a lightuserdata index in the registry. */
-static int marshalling_L_address;
+/* Callable metatable is referenced from per-state block, see
+   LuaGObjectState. */
 
 /* Structure containing basic callback information. */
 typedef struct _Callback
@@ -113,9 +202,9 @@ typedef struct _Callback
   lua_State *L;
   int thread_ref;
 
-  /* State lock, to be passed to lua_gobject_state_enter() when callback is
-     invoked. */
-  gpointer state_lock;
+  /* Per-state block; its lock is passed to lua_gobject_state_enter()
+     when callback is invoked. */
+  LuaGObjectState *state;
 } Callback;
 
 typedef struct _FfiClosureBlock FfiClosureBlock;
@@ -129,23 +218,22 @@ typedef struct _FfiClosure
   /* Pointer to the block to which this closure belongs. */
   FfiClosureBlock *block;
 
-  union
-  {
-    struct
-    {
-      /* Lua reference to associated Callable. */
-      int callable_ref;
+  /* Lua reference to associated Callable, valid when prepared is
+     set. */
+  int callable_ref;
 
-      /* Callable's target to be invoked (either function,
-	 userdata/table with __call metafunction or coroutine (which
-	 is resumed instead of called). */
-      int target_ref;
-    };
+  /* Callable's target to be invoked (either function, userdata/table
+     with __call metafunction or coroutine (which is resumed instead of
+     called), valid when created is set. */
+  int target_ref;
 
-    /* Closure's entry point, stored only temporarily until closure is
-       created. */
-    gpointer call_addr;
-  };
+  /* Closure's entry point. */
+  gpointer call_addr;
+
+  /* Callable for which the closure code was prepared, NULL if not
+     prepared yet.  Pooled closures keep it, so that they can be reused
+     for the same callable without preparing the code again. */
+  Callable *prepared;
 
   /* Flag indicating whether closure should auto-destroy itself after it is
      called. */
@@ -169,6 +257,11 @@ struct _FfiClosureBlock
      contained already in this header. */
   int closures_count;
 
+  /* Number of arguments sharing the block; interned blocks are shared
+     by all arguments with the same target and callable. */
+  int ref_count;
+  gboolean interned;
+
   /* Variable-length array of pointers to other closures.
      Unfortunately libffi does not allow to allocate contiguous block
      containing more closures, otherwise this array would simply
@@ -177,9 +270,171 @@ struct _FfiClosureBlock
   FfiClosure *ffi_closures[1];
 };
 
+/* Maximal count of released closure blocks kept in the pool. */
+#define CLOSURE_POOL_SIZE 16
+
+/* Per-state store of closure data.  Lua values referenced by
+   closures (their threads, callables and targets) are kept in
+   dedicated table referenced by state->closure_refs instead of
+   LUA_REGISTRYINDEX, with the list of free slots maintained here, so
+   that referencing a value touches neither the registry nor its free
+   list. */
+typedef struct _ClosureStore
+{
+  /* Highest slot ever used, and stack of released slots. */
+  int top;
+  int n_free, free_size;
+  int *free;
+
+  /* Pool of released single-closure blocks, reused by following
+     closures instead of allocating new executable memory.  Blocks are
+     kept in order of release, most recent last. */
+  int n_pooled;
+  FfiClosureBlock *pooled[CLOSURE_POOL_SIZE];
+
+  /* Count of all threads in the callback thread pool (table
+     referenced by state->callback_threads), and of idle ones.  Idle
+     threads occupy the beginning of the table, busy ones follow. */
+  int n_threads, n_idle_threads;
+
+  /* Set when the store was finalized while the state is being
+     closed; closures destroyed afterwards must not touch it. */
+  gboolean closed;
+} ClosureStore;
+#define UD_CLOSURE_STORE "lua_gobject.closure_store"
+
+/* lightuserdata key to the closure store of the state. */
+static int closure_store;
+
+/* Pushes value stored in given slot of the closure store.  Hot paths
+   keep the table on the stack and read slots directly instead. */
+static void
+closure_get (lua_State *L, LuaGObjectState *state, int slot)
+{
+  lua_gobject_state_push (L, state, closure_refs);
+  lua_rawgeti (L, -1, slot);
+  lua_replace (L, -2);
+}
+
+/* Pops value from the stack and stores it into given slot. */
+static void
+closure_set (lua_State *L, LuaGObjectState *state, int slot)
+{
+  lua_gobject_state_push (L, state, closure_refs);
+  lua_insert (L, -2);
+  lua_rawseti (L, -2, slot);
+  lua_pop (L, 1);
+}
+
+/* Pops value from the stack and stores it into newly allocated slot,
+   which is returned. */
+int
+lua_gobject_closure_ref (lua_State *L, LuaGObjectState *state)
+{
+  ClosureStore *store = state->closure_store;
+  int slot = (store->n_free > 0) ? store->free[--store->n_free] : ++store->top;
+  closure_set (L, state, slot);
+  return slot;
+}
+
+/* Takes an idle thread from the pool of callback threads, creating a
+   new one when all threads are busy.  Taken threads stay anchored in
+   the pool, so they need not be referenced elsewhere. */
+lua_State *
+lua_gobject_callback_thread_acquire (lua_State *L, LuaGObjectState *state)
+{
+  ClosureStore *store = state->closure_store;
+  lua_State *thread;
+
+  lua_gobject_state_push (L, state, callback_threads);
+  if (store->n_idle_threads > 0)
+    {
+      lua_rawgeti (L, -1, store->n_idle_threads--);
+      thread = lua_tothread (L, -1);
+      lua_pop (L, 1);
+    }
+  else
+    {
+      thread = lua_newthread (L);
+      lua_rawseti (L, -2, ++store->n_threads);
+    }
+
+  lua_pop (L, 1);
+  return thread;
+}
+
+/* Returns thread taken by lua_gobject_callback_thread_acquire() to
+   the pool.  Its own (emptied) stack is used for the bookkeeping. */
+void
+lua_gobject_callback_thread_release (LuaGObjectState *state, lua_State *L)
+{
+  ClosureStore *store = state->closure_store;
+  int i = ++store->n_idle_threads, j;
+
+  lua_settop (L, 0);
+  lua_gobject_state_push (L, state, callback_threads);
+  lua_rawgeti (L, -1, i);
+  if (lua_tothread (L, -1) != L)
+    {
+      /* Threads were not released in reverse order of acquisition,
+	 swap the thread with the first busy one. */
+      for (j = i + 1; j <= store->n_threads; j++)
+	{
+	  lua_rawgeti (L, -2, j);
+	  if (lua_tothread (L, -1) == L)
+	    break;
+	  lua_pop (L, 1);
+	}
+      g_assert (j <= store->n_threads);
+      lua_rawseti (L, -3, i);
+      lua_rawseti (L, -2, j);
+    }
+  else
+    lua_pop (L, 1);
+  lua_pop (L, 1);
+}
+
+/* Releases the slot, LUA_NOREF is ignored. */
+void
+lua_gobject_closure_unref (lua_State *L, LuaGObjectState *state, int slot)
+{
+  ClosureStore *store = state->closure_store;
+  if (slot <= 0 || store->closed)
+    return;
+
+  /* Store false instead of nil, so that the table keeps all slots in
+     its array part. */
+  lua_pushboolean (L, 0);
+  closure_set (L, state, slot);
+  if (store->n_free == store->free_size)
+    {
+      store->free_size = MAX (16, store->free_size * 2);
+      store->free = g_renew (int, store->free, store->free_size);
+    }
+  store->free[store->n_free++] = slot;
+}
+
 /* lightuserdata key to callable cache table. */
 static int callable_cache;
 
+/* lightuserdata key to the table with nonblocking policy, mapping
+   namespace name to either true (all functions of the namespace are
+   nonblocking) or function name prefix (only matching functions are
+   nonblocking). */
+static int callable_nonblocking;
+
+/* When set, callbacks check that they are not invoked from inside
+   nonblocking call.  Calls and callbacks run on arbitrary threads, so
+   it is accessed atomically. */
+static gint nonblocking_check;
+
+/* Nonblocking Callable currently being called by this thread, used
+   only when nonblocking_check is enabled. */
+static GPrivate nonblocking_call;
+
+/* Number of callbacks detected inside nonblocking calls. */
+static gint nonblocking_violations;
+
 /* Gets ffi_type for given tag, returns NULL if it cannot be handled. */
 static ffi_type *
 get_simple_ffi_type (GITypeTag tag)
@@ -286,8 +541,7 @@ callable_allocate (lua_State *L, int nargs, ffi_type ***ffi_args)
 					sizeof (ffi_type) * (nargs + 2) +
 					sizeof (Param) * nargs);
   memset (callable, 0, sizeof *callable);
-  lua_pushlightuserdata (L, &callable_mt);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, lua_gobject_state_get (L), callable_mt);
   lua_setmetatable (L, -2);
 
   /* Inititialize callable contents. */
@@ -331,6 +585,145 @@ callable_get_param (Callable *callable, gint n)
   return param;
 }
 
+/* Resolves and caches everything needed for marshalling of the
+   parameter, so that calls do not need to query typeinfo. */
+static void
+callable_param_compile (Param *param)
+{
+  param->op = PARAM_OP_GENERIC;
+  param->optional = TRUE;
+  if (param->ti == NULL)
+    return;
+
+  param->tag = gi_type_info_get_tag (param->ti);
+  if (param->has_arg_info)
+    {
+      param->optional = gi_arg_info_is_optional (&param->ai)
+	|| gi_arg_info_may_be_null (&param->ai);
+      param->caller_alloc = gi_arg_info_is_caller_allocates (&param->ai);
+    }
+
+  if (param->kind != PARAM_KIND_TI)
+    return;
+
+  switch (param->tag)
+    {
+    case GI_TYPE_TAG_BOOLEAN:
+      param->op = PARAM_OP_BOOLEAN;
+      break;
+
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_UNICHAR:
+    case GI_TYPE_TAG_GTYPE:
+      param->op = PARAM_OP_INT;
+      break;
+
+    case GI_TYPE_TAG_FLOAT:
+      param->op = PARAM_OP_FLOAT;
+      break;
+
+    case GI_TYPE_TAG_DOUBLE:
+      param->op = PARAM_OP_DOUBLE;
+      break;
+
+    case GI_TYPE_TAG_UTF8:
+      param->op = PARAM_OP_UTF8;
+      break;
+
+    case GI_TYPE_TAG_INTERFACE:
+      {
+	GIBaseInfo *ii = gi_type_info_get_interface (param->ti);
+	if (GI_IS_OBJECT_INFO (ii) || GI_IS_INTERFACE_INFO (ii))
+	  {
+	    param->op = PARAM_OP_OBJECT;
+	    param->gtype = gi_registered_type_info_get_g_type
+	      (GI_REGISTERED_TYPE_INFO (ii));
+	  }
+	gi_base_info_unref (ii);
+	break;
+      }
+
+    default:
+      break;
+    }
+}
+
+/* Checks whether precompiled operation of the parameter is numeric
+   or boolean scalar. */
+static gboolean
+callable_param_is_scalar (Param *param)
+{
+  return param->op == PARAM_OP_BOOLEAN || param->op == PARAM_OP_INT
+    || param->op == PARAM_OP_FLOAT || param->op == PARAM_OP_DOUBLE;
+}
+
+/* Precompiles marshalling plan for return value and all parameters. */
+static void
+callable_compile (Callable *callable)
+{
+  int i;
+
+  callable_param_compile (&callable->retval);
+  for (i = 0; i < callable->nargs; i++)
+    callable_param_compile (&callable->params[i]);
+
+  callable->has_retval = callable->retval.ti == NULL
+    || callable->retval.tag != GI_TYPE_TAG_VOID
+    || gi_type_info_is_pointer (callable->retval.ti);
+
+  /* Detect callables taking and returning only scalars, without any
+     output arguments, closures or errors.  Phantom boolean return
+     values need conversion done only by the generic path. */
+  callable->is_scalar = !callable->throws && !callable->is_closure_marshal
+    && !callable->ignore_retval
+    && callable->has_self + callable->nargs <= CALLABLE_SCALAR_MAX_ARGS
+    && (!callable->has_retval || callable_param_is_scalar (&callable->retval));
+  for (i = 0; i < callable->nargs && callable->is_scalar; i++)
+    {
+      Param *param = &callable->params[i];
+      if (param->dir != GI_DIRECTION_IN || param->internal
+	  || param->n_closures > 0 || !callable_param_is_scalar (param))
+	callable->is_scalar = 0;
+    }
+
+  /* Only generic marshalling of input arguments and closure blocks
+     can create temporaries. */
+  callable->needs_arena = 0;
+  for (i = 0; i < callable->nargs; i++)
+    {
+      Param *param = &callable->params[i];
+      if (param->n_closures > 0
+	  || (!param->internal && param->dir != GI_DIRECTION_OUT
+	      && param->op == PARAM_OP_GENERIC))
+	callable->needs_arena = 1;
+    }
+}
+
+/* Sets nonblocking flag of the callable according to the policy
+   registered for its namespace. */
+static void
+callable_apply_nonblocking (lua_State *L, Callable *callable)
+{
+  luaL_checkstack (L, 2, NULL);
+  lua_pushlightuserdata (L, &callable_nonblocking);
+  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_getfield (L, -1, gi_base_info_get_namespace (GI_BASE_INFO (callable->info)));
+  if (lua_type (L, -1) == LUA_TSTRING)
+    callable->nonblocking =
+      g_str_has_prefix (gi_base_info_get_name (GI_BASE_INFO (callable->info)),
+			lua_tostring (L, -1));
+  else
+    callable->nonblocking = lua_toboolean (L, -1);
+  lua_pop (L, 2);
+}
+
 int
 lua_gobject_callable_create (lua_State *L, GICallableInfo *info, gpointer addr)
 {
@@ -369,6 +762,26 @@ lua_gobject_callable_create (lua_State *L, GICallableInfo *info, gpointer addr)
        emitted. */
     callable->has_self = 1;
 
+  /* Resolve kind and type of 'self' argument.  Repotype table of
+     record 'self' is resolved lazily on first use, because it might
+     not be available while the type itself is being loaded. */
+  if (callable->has_self)
+    {
+      GIBaseInfo *parent = gi_base_info_get_container (GI_BASE_INFO (info));
+      if (GI_IS_OBJECT_INFO (parent) || GI_IS_INTERFACE_INFO (parent))
+	{
+	  callable->self_kind = CALLABLE_SELF_OBJECT;
+	  callable->self_gtype = gi_registered_type_info_get_g_type (
+	    GI_REGISTERED_TYPE_INFO (parent));
+	}
+      else
+	{
+	  callable->self_kind = CALLABLE_SELF_RECORD;
+	  lua_newtable (L);
+	  lua_setfenv (L, -2);
+	}
+    }
+
   /* Process return value. */
   callable->retval.ti = gi_callable_info_get_return_type (callable->info);
   callable->retval.dir = GI_DIRECTION_OUT;
@@ -444,6 +857,13 @@ lua_gobject_callable_create (lua_State *L, GICallableInfo *info, gpointer addr)
   if (callable->throws)
     *ffi_arg++ = &ffi_type_pointer;
 
+  /* Prepare marshalling plan. */
+  callable_compile (callable);
+
+  /* Apply nonblocking policy of the namespace. */
+  if (GI_IS_FUNCTION_INFO (info))
+    callable_apply_nonblocking (L, callable);
+
   /* Create ffi_cif. */
   if (ffi_prep_cif (&callable->cif, FFI_DEFAULT_ABI,
 		    callable->has_self + nargs + callable->throws,
@@ -554,6 +974,43 @@ callable_param_parse (lua_State *L, Param *param)
     luaL_error (L, "bad efn def");
 }
 
+int
+lua_gobject_callable_create_callback (lua_State *L, GICallableInfo *ci)
+{
+  GIBaseInfo *info = GI_BASE_INFO (ci);
+
+  /* Names of nested or anonymous callbacks are not unique, do not
+     cache them. */
+  if (gi_base_info_get_container (info) != NULL
+      || gi_base_info_get_name (info) == NULL)
+    return lua_gobject_callable_create (L, ci, NULL);
+
+  luaL_checkstack (L, 4, NULL);
+  lua_pushlightuserdata (L, &callable_cache);
+  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_pushfstring (L, "%s.%s", gi_base_info_get_namespace (info),
+		   gi_base_info_get_name (info));
+  lua_pushvalue (L, -1);
+  lua_rawget (L, -3);
+  if (lua_isnil (L, -1))
+    {
+      /* Create the callable and store it into the cache. */
+      lua_pop (L, 1);
+      lua_gobject_callable_create (L, ci, NULL);
+      lua_pushvalue (L, -1);
+      lua_insert (L, -4);
+      lua_rawset (L, -3);
+      lua_pop (L, 1);
+    }
+  else
+    {
+      lua_replace (L, -3);
+      lua_pop (L, 1);
+    }
+
+  return 1;
+}
+
 /* Parses callable from given table. */
 int
 lua_gobject_callable_parse (lua_State *L, int info, gpointer addr)
@@ -613,6 +1070,9 @@ lua_gobject_callable_parse (lua_State *L, int info, gpointer addr)
   if (callable->throws)
     ffi_args[i] = &ffi_type_pointer;
 
+  /* Prepare marshalling plan. */
+  callable_compile (callable);
+
   /* Create ffi_cif. */
   if (ffi_prep_cif (&callable->cif, FFI_DEFAULT_ABI,
 		    nargs + callable->throws,
@@ -624,15 +1084,15 @@ lua_gobject_callable_parse (lua_State *L, int info, gpointer addr)
   return 1;
 }
 
-/* Checks whether given argument is Callable userdata. */
+/* Checks whether given argument is Callable userdata, using
+   metatable referenced from given per-state block. */
 static Callable *
-callable_get (lua_State *L, int narg)
+callable_check (lua_State *L, LuaGObjectState *state, int narg)
 {
   luaL_checkstack (L, 3, "");
   if (lua_getmetatable (L, narg))
     {
-      lua_pushlightuserdata (L, &callable_mt);
-      lua_rawget (L, LUA_REGISTRYINDEX);
+      lua_gobject_state_push (L, state, callable_mt);
       if (lua_rawequal (L, -1, -2))
 	{
 	  lua_pop (L, 2);
@@ -646,6 +1106,13 @@ callable_get (lua_State *L, int narg)
   return NULL;
 }
 
+/* Checks whether given argument is Callable userdata. */
+static Callable *
+callable_get (lua_State *L, int narg)
+{
+  return callable_check (L, lua_gobject_state_get (L), narg);
+}
+
 static void
 callable_param_destroy (Param *param)
 {
@@ -685,7 +1152,7 @@ callable_describe (lua_State *L, Callable *callable, FfiClosure *closure)
   else
     {
       gconstpointer ptr;
-      lua_rawgeti (L, LUA_REGISTRYINDEX, closure->target_ref);
+      closure_get (L, closure->block->callback.state, closure->target_ref);
       ptr = lua_topointer (L, -1);
       if (ptr != NULL)
 	lua_pushfstring (L, "%s: %p", luaL_typename (L, -1),
@@ -726,12 +1193,132 @@ callable_tostring (lua_State *L)
   return 1;
 }
 
+/* Marshals parameter with precompiled operation to C.  Returns FALSE
+   if the parameter has to be marshalled generically. */
+static gboolean
+callable_param_2c_op (lua_State *L, Param *param, int narg, int parent,
+		      GIArgument *arg)
+{
+  gboolean optional = param->optional
+    || parent == LUA_GOBJECT_PARENT_CALLER_ALLOC;
+
+  switch (param->op)
+    {
+    case PARAM_OP_BOOLEAN:
+      if (parent == LUA_GOBJECT_PARENT_IS_RETVAL)
+	{
+	  union { GIArgument arg; ffi_sarg s; } *u = (gpointer) arg;
+	  u->s = lua_toboolean (L, narg) ? TRUE : FALSE;
+	}
+      else
+	arg->v_boolean = lua_toboolean (L, narg) ? TRUE : FALSE;
+      return TRUE;
+
+    case PARAM_OP_INT:
+      lua_gobject_marshal_2c_int (L, param->tag, arg, narg, optional, parent);
+      return TRUE;
+
+    case PARAM_OP_FLOAT:
+    case PARAM_OP_DOUBLE:
+      {
+	lua_Number num = (optional && lua_isnoneornil (L, narg))
+	  ? 0 : luaL_checknumber (L, narg);
+	if (param->op == PARAM_OP_FLOAT)
+	  arg->v_float = (float) num;
+	else
+	  arg->v_double = (double) num;
+	return TRUE;
+      }
+
+    case PARAM_OP_UTF8:
+      {
+	gchar *str = NULL;
+	int type = lua_type (L, narg);
+	if (type == LUA_TLIGHTUSERDATA)
+	  str = lua_touserdata (L, narg);
+	else if (!optional || (type != LUA_TNIL && type != LUA_TNONE))
+	  {
+	    if (type == LUA_TUSERDATA)
+	      str = ((param->dir != GI_DIRECTION_IN
+		      && parent != LUA_GOBJECT_PARENT_IS_RETVAL)
+		     || parent == LUA_GOBJECT_PARENT_CALLER_ALLOC)
+		? lua_gobject_buffer_test_writable (L, narg, NULL)
+		: lua_gobject_buffer_test (L, narg, NULL);
+	    if (str == NULL)
+	      str = (gchar *) luaL_checkstring (L, narg);
+	  }
+	arg->v_string = (param->transfer == GI_TRANSFER_EVERYTHING)
+	  ? g_strdup (str) : str;
+	return TRUE;
+      }
+
+    case PARAM_OP_OBJECT:
+      arg->v_pointer =
+	lua_gobject_object_2c (L, narg, param->gtype, optional, FALSE,
+			       param->transfer != GI_TRANSFER_NOTHING);
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/* Marshals parameter with precompiled operation to Lua.  Returns
+   FALSE if the parameter has to be marshalled generically. */
+static gboolean
+callable_param_2lua_op (lua_State *L, Param *param, GIArgument *arg,
+			int parent)
+{
+  switch (param->op)
+    {
+    case PARAM_OP_BOOLEAN:
+      if (parent == LUA_GOBJECT_PARENT_IS_RETVAL)
+	{
+	  union { GIArgument arg; ffi_sarg s; } *u = (gpointer) arg;
+	  arg->v_boolean = (gboolean) u->s;
+	}
+      lua_pushboolean (L, arg->v_boolean);
+      return TRUE;
+
+    case PARAM_OP_INT:
+      lua_gobject_marshal_2lua_int (L, param->tag, arg, parent);
+      return TRUE;
+
+    case PARAM_OP_FLOAT:
+      lua_pushnumber (L, arg->v_float);
+      return TRUE;
+
+    case PARAM_OP_DOUBLE:
+      lua_pushnumber (L, arg->v_double);
+      return TRUE;
+
+    case PARAM_OP_UTF8:
+      lua_pushstring (L, arg->v_string);
+      if (param->transfer == GI_TRANSFER_EVERYTHING)
+	g_free (arg->v_string);
+      return TRUE;
+
+    case PARAM_OP_OBJECT:
+      lua_gobject_object_2lua (L, arg->v_pointer,
+			       param->transfer != GI_TRANSFER_NOTHING,
+			       param->dir == GI_DIRECTION_IN);
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
 static int
 callable_param_2c (lua_State *L, Param *param, int narg, int parent,
 		   GIArgument *arg, int callable_index,
-		   Callable *callable, void **args)
+		   Callable *callable, void **args, gboolean in_call)
 {
   int nret = 0;
+  if (param->op != PARAM_OP_GENERIC
+      && callable_param_2c_op (L, param, narg, parent, arg))
+    return 0;
+
   if (param->kind == PARAM_KIND_ENUM && lua_type (L, narg) != LUA_TNUMBER)
     {
       /* Convert enum symbolic value to numeric one. */
@@ -748,7 +1335,8 @@ callable_param_2c (lua_State *L, Param *param, int narg, int parent,
 	nret = lua_gobject_marshal_2c (L, param->ti,
 			       param->has_arg_info ? &param->ai : NULL,
 			       param->transfer, arg, narg, parent,
-			       callable->info, args + callable->has_self);
+			       callable->info, args + callable->has_self,
+			       in_call);
       else
 	{
 	  union { GIArgument arg; int i; } *u = (gpointer) arg;
@@ -777,6 +1365,24 @@ callable_param_2lua (lua_State *L, Param *param, GIArgument *arg,
 		     int parent, int callable_index,
 		     Callable *callable, void **args)
 {
+  if (param->op != PARAM_OP_GENERIC
+      && callable_param_2lua_op (L, param, arg, parent))
+    return;
+
+  if (callable->array_views && param->tag == GI_TYPE_TAG_ARRAY
+      && param->dir != GI_DIRECTION_IN && param->ti
+      && lua_gobject_marshal_2lua_array_view (L, param->ti, param->transfer,
+					      arg, callable->info,
+					      args + callable->has_self))
+    return;
+
+  if (callable->lazy_containers && param->dir != GI_DIRECTION_IN
+      && (param->tag == GI_TYPE_TAG_GLIST || param->tag == GI_TYPE_TAG_GSLIST
+	  || param->tag == GI_TYPE_TAG_GHASH) && param->ti
+      && lua_gobject_marshal_2lua_lazy (L, param->ti, param->dir,
+					param->transfer, arg->v_pointer))
+    return;
+
   if (param->kind != PARAM_KIND_RECORD)
     {
       if (param->ti)
@@ -813,30 +1419,258 @@ callable_param_2lua (lua_State *L, Param *param, GIArgument *arg,
     }
 }
 
-static int
-callable_call (lua_State *L)
+/* Pushes repotype table of CALLABLE_SELF_RECORD 'self' argument of
+   the callable at given stack index, resolving it on the first use and
+   caching it in the env table of the callable. */
+static void
+callable_self_repotype (lua_State *L, Callable *callable, int callable_index)
 {
-  Param *param;
-  int i, lua_argi, nret, caller_allocated = 0, nargs;
-  GIArgument retval, *args;
-  void **ffi_args, **redirect_out;
-  GError *err = NULL;
-  gpointer state_lock = lua_gobject_state_get_lock (L);
-  Callable *callable = callable_get (L, 1);
+  luaL_checkstack (L, 4, "");
+  lua_getfenv (L, callable_index);
+  lua_rawgeti (L, -1, CALLABLE_ENV_SELF_REPOTYPE);
+  if (G_UNLIKELY (lua_isnil (L, -1)))
+    {
+      lua_pop (L, 1);
+      lua_gobject_type_get_repotype (L, G_TYPE_INVALID,
+				     gi_base_info_get_container (GI_BASE_INFO (callable->info)));
+      lua_pushvalue (L, -1);
+      lua_rawseti (L, -3, CALLABLE_ENV_SELF_REPOTYPE);
+    }
+  lua_replace (L, -2);
+}
 
-  /* Make sure that all unspecified arguments are set as nil; during
-     marshalling we might create temporary values on the stack, which
-     can be confused with input arguments expected but not passed by
-     caller. */
-  lua_settop(L, callable->has_self + callable->nargs + 1);
+/* Marshals 'self' argument of the callable from Lua stack position
+   narg into the target.  Callable itself is expected at position 1. */
+static void
+callable_self_2c (lua_State *L, Callable *callable, int narg,
+		  GIArgument *target)
+{
+  if (callable->self_kind == CALLABLE_SELF_OBJECT)
+    target->v_pointer = lua_gobject_object_2c (L, narg, callable->self_gtype,
+					       FALSE, FALSE, FALSE);
+  else
+    {
+      callable_self_repotype (L, callable, 1);
+      lua_gobject_record_2c (L, narg, &target->v_pointer, FALSE, FALSE, FALSE, FALSE);
+    }
+}
 
-  /* We cannot push more stuff than count of arguments we have. */
-  luaL_checkstack (L, callable->nargs, "");
+/* Performs the actual call of the C function, releasing state lock
+   for the duration of the call unless the callable is nonblocking. */
+static void
+callable_invoke (Callable *callable, gpointer state_lock, void *retval,
+		 void **ffi_args)
+{
+  if (callable->nonblocking)
+    {
+      if (G_UNLIKELY (g_atomic_int_get (&nonblocking_check)))
+	{
+	  gpointer outer = g_private_get (&nonblocking_call);
+	  g_private_set (&nonblocking_call, callable);
+	  ffi_call (&callable->cif, callable->address, retval, ffi_args);
+	  g_private_set (&nonblocking_call, outer);
+	}
+      else
+	ffi_call (&callable->cif, callable->address, retval, ffi_args);
+      return;
+    }
 
-  /* Prepare data for the call. */
-  nargs = callable->nargs + callable->has_self;
-  args = g_newa (GIArgument, nargs);
-  redirect_out = g_newa (void *, nargs + callable->throws);
+  /* Unlock the state. */
+  lua_gobject_state_leave (state_lock);
+
+  /* Call the function. */
+  ffi_call (&callable->cif, callable->address, retval, ffi_args);
+
+  /* Heading back to Lua, lock the state back again. */
+  lua_gobject_state_enter (state_lock);
+}
+
+/* Simplified variant of callable_call() for callables with is_scalar
+   flag.  Such callables cannot create any temporary values, output
+   values or closures, so all bookkeeping is avoided and arguments are
+   converted directly into ffi argument slots. */
+static int
+callable_call_scalar (lua_State *L, Callable *callable, gpointer state_lock)
+{
+  GIArgument args[CALLABLE_SCALAR_MAX_ARGS], retval;
+  void *ffi_args[CALLABLE_SCALAR_MAX_ARGS];
+  Param *param = callable->params;
+  int i, argi = 0;
+
+  /* Make sure that unspecified arguments are nil. */
+  lua_settop (L, callable->has_self + callable->nargs + 1);
+
+  if (callable->has_self)
+    {
+      callable_self_2c (L, callable, 2, &args[0]);
+      ffi_args[0] = &args[0];
+      argi++;
+    }
+
+  for (i = 0; i < callable->nargs; i++, argi++, param++)
+    {
+      callable_param_2c_op (L, param, argi + 2, 0, &args[argi]);
+      ffi_args[argi] = &args[argi];
+    }
+
+  callable_invoke (callable, state_lock, &retval, ffi_args);
+
+  if (!callable->has_retval)
+    return 0;
+
+  callable_param_2lua_op (L, &callable->retval, &retval,
+			  LUA_GOBJECT_PARENT_IS_RETVAL);
+  return 1;
+}
+
+/* Looks up closure block interned for the Lua target and callback
+   type of the callback bound to user_data parameter i, before any
+   closure is allocated and prepared for the call.  Returns the block
+   with its reference taken, or NULL if there is no such block yet.
+   Table of interned blocks maps targets to tables of blocks keyed by
+   their prepared Callable. */
+static FfiClosureBlock *
+callable_intern_lookup (lua_State *L, LuaGObjectState *state,
+			Callable *callable, int i)
+{
+  FfiClosureBlock *interned = NULL;
+  GIBaseInfo *ci;
+  Param *param;
+  int j, narg = 2 + callable->has_self;
+  guint arg;
+
+  /* Find the callback and its Lua argument. */
+  for (j = 0, param = callable->params; j < callable->nargs; j++, param++)
+    {
+      if (param->has_arg_info
+	  && gi_arg_info_get_scope (&param->ai) != GI_SCOPE_TYPE_INVALID
+	  && gi_arg_info_get_closure_index (&param->ai, &arg)
+	  && arg == (guint) i)
+	break;
+      if (!param->internal && param->dir != GI_DIRECTION_OUT)
+	narg++;
+    }
+
+  /* Only closures invoking Lua target can be shared. */
+  if (j == callable->nargs || lua_isnoneornil (L, narg)
+      || lua_islightuserdata (L, narg) || lua_isthread (L, narg))
+    return NULL;
+
+  /* Callables of nested or anonymous callbacks are not cached, so
+     closures prepared for them never match. */
+  ci = gi_type_info_get_interface (param->ti);
+  if (gi_base_info_get_container (ci) != NULL
+      || gi_base_info_get_name (ci) == NULL)
+    {
+      gi_base_info_unref (ci);
+      return NULL;
+    }
+
+  luaL_checkstack (L, 4, NULL);
+  lua_gobject_callable_create_callback (L, GI_CALLABLE_INFO (ci));
+  gi_base_info_unref (ci);
+  lua_gobject_state_push (L, state, closure_interned);
+  lua_pushvalue (L, narg);
+  lua_rawget (L, -2);
+  if (lua_istable (L, -1))
+    {
+      lua_pushlightuserdata (L, lua_touserdata (L, -3));
+      lua_rawget (L, -2);
+      interned = lua_touserdata (L, -1);
+      lua_pop (L, 1);
+    }
+  lua_pop (L, 3);
+
+  if (interned != NULL)
+    interned->ref_count++;
+  return interned;
+}
+
+/* Interns closure block passed as user_data argument argi, allocated
+   because callable_intern_lookup() found no block for its target and
+   callback type.  If the same target was passed in another argument
+   of this call, which interned its block meanwhile, replaces the block
+   by that one instead. */
+static void
+callable_intern_closure (lua_State *L, LuaGObjectState *state,
+			 Callable *callable, GIArgument *args, int argi)
+{
+  FfiClosureBlock *block = args[argi].v_pointer, *interned;
+  FfiClosure *closure = &block->ffi_closure;
+  Param *param;
+  int i;
+
+  /* Only closures invoking Lua target can be shared, and blocks found
+     by callable_intern_lookup() are interned already. */
+  if (block->interned || !closure->created
+      || closure->target_ref == LUA_NOREF)
+    return;
+
+  luaL_checkstack (L, 5, NULL);
+  lua_gobject_state_push (L, state, closure_interned);
+  closure_get (L, state, closure->target_ref);
+  lua_pushvalue (L, -1);
+  lua_rawget (L, -3);
+  if (lua_isnil (L, -1))
+    {
+      lua_pop (L, 1);
+      lua_newtable (L);
+      lua_pushvalue (L, -2);
+      lua_pushvalue (L, -2);
+      lua_rawset (L, -5);
+    }
+  lua_pushlightuserdata (L, closure->prepared);
+  lua_rawget (L, -2);
+  interned = lua_touserdata (L, -1);
+  lua_pop (L, 1);
+  if (interned == NULL)
+    {
+      lua_pushlightuserdata (L, closure->prepared);
+      lua_pushlightuserdata (L, block);
+      lua_rawset (L, -3);
+      block->interned = TRUE;
+    }
+  else
+    {
+      /* Redirect callback argument to the shared closure and drop the
+	 new block. */
+      for (i = 0, param = callable->params; i < callable->nargs;
+	   i++, param++)
+	if (param->has_arg_info
+	    && gi_arg_info_get_scope (&param->ai) != GI_SCOPE_TYPE_INVALID
+	    && args[i + callable->has_self].v_pointer == closure->call_addr)
+	  args[i + callable->has_self].v_pointer =
+	    interned->ffi_closure.call_addr;
+      args[argi].v_pointer = interned;
+      interned->ref_count++;
+      lua_gobject_closure_release (block);
+    }
+  lua_pop (L, 3);
+}
+
+/* Generic variant of callable_call(), marshalling arguments and
+   results of any callable.  Expects exactly the callable and its
+   arguments on the stack.  When callable->needs_arena is set, the
+   arena of the call is already current and lies above them. */
+static int
+callable_call_generic (lua_State *L, LuaGObjectState *state,
+		       Callable *callable)
+{
+  Param *param;
+  int i, lua_argi, nret, caller_allocated = 0, nargs;
+  GIArgument retval, *args;
+  void **ffi_args, **redirect_out;
+  GError *err = NULL;
+  gpointer state_lock = state->lock;
+  gboolean in_call = callable->needs_arena;
+
+  /* We cannot push more stuff than count of arguments we have. */
+  luaL_checkstack (L, callable->nargs + 1, "");
+
+  /* Prepare data for the call. */
+  nargs = callable->nargs + callable->has_self;
+  args = g_newa (GIArgument, nargs);
+  redirect_out = g_newa (void *, nargs + callable->throws);
   ffi_args = g_newa (void *, nargs + callable->throws);
 
   /* Prepare 'self', if present. */
@@ -844,21 +1678,7 @@ callable_call (lua_State *L)
   nret = 0;
   if (callable->has_self)
     {
-      GIBaseInfo *parent = gi_base_info_get_container (GI_BASE_INFO (callable->info));
-      if (GI_IS_OBJECT_INFO (parent) || GI_IS_INTERFACE_INFO (parent))
-	{
-	  args[0].v_pointer =
-	    lua_gobject_object_2c (L, 2, gi_registered_type_info_get_g_type (GI_REGISTERED_TYPE_INFO (parent)),
-			   FALSE, FALSE, FALSE);
-	  nret++;
-	}
-      else
-	{
-	  lua_gobject_type_get_repotype (L, G_TYPE_INVALID, parent);
-	  lua_gobject_record_2c (L, 2, &args[0].v_pointer, FALSE, FALSE, FALSE, FALSE);
-	  nret++;
-	}
-
+      callable_self_2c (L, callable, 2, &args[0]);
       ffi_args[0] = &args[0];
       lua_argi++;
     }
@@ -883,16 +1703,24 @@ callable_call (lua_State *L)
 
       if (param->n_closures > 0)
 	{
-	  args[argi].v_pointer = lua_gobject_closure_allocate (L, param->n_closures);
+	  /* Reuse interned closure without allocating and preparing new
+	     one, if possible. */
+	  args[argi].v_pointer = NULL;
+	  if (callable->intern_closures && param->n_closures == 1
+	      && !param->call_scoped_user_data)
+	    args[argi].v_pointer =
+	      callable_intern_lookup (L, state, callable, i);
+	  if (args[argi].v_pointer == NULL)
+	    args[argi].v_pointer =
+	      lua_gobject_closure_allocate (L, param->n_closures);
 	  if (param->call_scoped_user_data)
-	    /* Add guard which releases closure block after the
-	       call. */
-	    *lua_gobject_guard_create (L, lua_gobject_closure_destroy) = args[argi].v_pointer;
+	    /* Release closure block after the call. */
+	    *lua_gobject_arena_guard (L, in_call, lua_gobject_closure_release,
+				      &nret) = args[argi].v_pointer;
 	}
     }
 
   /* Process input parameters. */
-  nret = 0;
   param = &callable->params[0];
   for (i = 0; i < callable->nargs; i++, param++)
     if (!param->internal)
@@ -900,10 +1728,10 @@ callable_call (lua_State *L)
 	int argi = i + callable->has_self;
 	if (param->dir != GI_DIRECTION_OUT)
 	  nret += callable_param_2c (L, param, lua_argi++, 0, &args[argi],
-				     1, callable, ffi_args);
+				     1, callable, ffi_args, in_call);
 	/* Special handling for out/caller-alloc structures; we have to
 	   manually pre-create them and store them on the stack. */
-	else if (callable->info && gi_arg_info_is_caller_allocates (&param->ai)
+	else if (param->caller_alloc
 		 && lua_gobject_marshal_2c_caller_alloc (L, param->ti, &args[argi], 0))
 	  {
 	    /* Even when marked as OUT, caller-allocates arguments
@@ -924,6 +1752,14 @@ callable_call (lua_State *L)
       /* Provide userdata for the callback. */
       args[i + callable->has_self].v_pointer = callable->user_data;
 
+  /* Share closures with previous calls, if requested. */
+  if (callable->intern_closures)
+    for (i = 0; i < callable->nargs; i++)
+      if (callable->params[i].n_closures == 1
+	  && !callable->params[i].call_scoped_user_data)
+	callable_intern_closure (L, state, callable, args,
+				 i + callable->has_self);
+
   /* Add error for 'throws' type function. */
   if (callable->throws)
     {
@@ -931,14 +1767,8 @@ callable_call (lua_State *L)
       ffi_args[nargs] = &redirect_out[nargs];
     }
 
-  /* Unlock the state. */
-  lua_gobject_state_leave (state_lock);
-
   /* Call the function. */
-  ffi_call (&callable->cif, callable->address, &retval, ffi_args);
-
-  /* Heading back to Lua, lock the state back again. */
-  lua_gobject_state_enter (state_lock);
+  callable_invoke (callable, state_lock, &retval, ffi_args);
 
   /* Pop any temporary items from the stack which might be stored there by
      marshalling code. */
@@ -946,10 +1776,7 @@ callable_call (lua_State *L)
 
   /* Handle return value. */
   nret = 0;
-  if (!callable->ignore_retval
-      && (callable->retval.ti == NULL
-	  || (gi_type_info_get_tag (callable->retval.ti) != GI_TYPE_TAG_VOID
-	      || gi_type_info_is_pointer (callable->retval.ti))))
+  if (!callable->ignore_retval && callable->has_retval)
     {
       callable_param_2lua (L, &callable->retval, &retval, LUA_GOBJECT_PARENT_IS_RETVAL,
 			   1, callable, ffi_args);
@@ -987,7 +1814,7 @@ callable_call (lua_State *L)
   for (i = 0; i < callable->nargs; i++, param++)
     if (!param->internal && param->dir != GI_DIRECTION_IN)
       {
-	if (callable->info && gi_arg_info_is_caller_allocates (&param->ai)
+	if (param->caller_alloc
 	    && lua_gobject_marshal_2c_caller_alloc (L, param->ti, NULL,
 					    -caller_allocated  - nret))
 	  /* Caller allocated parameter is already marshalled and
@@ -1026,6 +1853,212 @@ callable_call (lua_State *L)
   return nret;
 }
 
+static int
+callable_call (lua_State *L)
+{
+  int top, nret;
+
+  /* Per-state block is passed as an upvalue, so that the call does not
+     need any registry lookup to find the state lock. */
+  LuaGObjectState *state = lua_touserdata (L, lua_upvalueindex (1));
+  Callable *callable = callable_check (L, state, 1);
+
+  if (callable->is_scalar)
+    return callable_call_scalar (L, callable, state->lock);
+
+  /* Make sure that all unspecified arguments are set as nil; during
+     marshalling we might create temporary values on the stack, which
+     can be confused with input arguments expected but not passed by
+     caller. */
+  top = callable->has_self + callable->nargs + 1;
+  lua_settop (L, top);
+  if (!callable->needs_arena)
+    return callable_call_generic (L, state, callable);
+
+  /* Temporaries created while marshalling arguments are kept in the
+     arena and released all at once when the call returns.  The arena
+     stays on the stack right above the arguments, results are
+     returned from the top of the stack above it. */
+  lua_gobject_arena_open (L, state);
+  nret = callable_call_generic (L, state, callable);
+  lua_gobject_arena_close (L, state, top + 1);
+  return nret;
+}
+
+/* Pushes __call handler of callables for given per-state block. */
+static void
+callable_push_call (lua_State *L, LuaGObjectState *state)
+{
+  lua_pushlightuserdata (L, state);
+  lua_pushcclosure (L, callable_call, 1);
+}
+
+/* Pushes count Lua arguments of i-th call of the batch.  When rows is
+   nonzero, it is stack index of the array of row tables, each holding
+   arguments of one call.  Otherwise ncols columns starting at stack
+   index first are used; table column holds argument for each call,
+   any other value is passed to all calls. */
+static void
+callable_batch_push (lua_State *L, int rows, int first, int ncols, int i,
+		     int count)
+{
+  int j;
+  if (rows != 0)
+    {
+      int row = lua_gettop (L) + 1;
+      lua_rawgeti (L, rows, i);
+      if (!lua_istable (L, row))
+	luaL_error (L, "row %d is not a table", i);
+      for (j = 1; j <= count; j++)
+	lua_rawgeti (L, row, j);
+      lua_remove (L, row);
+    }
+  else
+    for (j = 0; j < count; j++)
+      {
+	if (j >= ncols)
+	  lua_pushnil (L);
+	else if (lua_istable (L, first + j))
+	  lua_rawgeti (L, first + j, i);
+	else
+	  lua_pushvalue (L, first + j);
+      }
+}
+
+/* Batch variant of callable_call_scalar().  All arguments of all calls
+   are marshalled first, then the state lock is released only once for
+   all the calls and finally return values are collected into single
+   table. */
+static int
+callable_batch_scalar (lua_State *L, Callable *callable, gpointer state_lock,
+		       int rows, int first, int ncols, int n)
+{
+  void *ffi_args[CALLABLE_SCALAR_MAX_ARGS];
+  int count = callable->has_self + callable->nargs;
+  int stride = count + 1, frame, i, argi;
+  GIArgument *args;
+
+  /* Arguments of i-th call are stored at args[i * stride], followed
+     by the slot for its return value. */
+  args = g_new (GIArgument, (gsize) n * stride);
+  *lua_gobject_guard_create (L, g_free) = args;
+  frame = lua_gettop (L) + 1;
+  for (i = 0; i < n; i++)
+    {
+      GIArgument *call_args = &args[i * stride];
+      Param *param = callable->params;
+      callable_batch_push (L, rows, first, ncols, i + 1, count);
+      argi = 0;
+      if (callable->has_self)
+	callable_self_2c (L, callable, frame + argi++, &call_args[0]);
+      for (; argi < count; argi++, param++)
+	callable_param_2c_op (L, param, frame + argi, 0, &call_args[argi]);
+      lua_settop (L, frame - 1);
+    }
+
+  /* Perform all the calls. */
+  if (!callable->nonblocking)
+    lua_gobject_state_leave (state_lock);
+  for (i = 0; i < n; i++)
+    {
+      for (argi = 0; argi < count; argi++)
+	ffi_args[argi] = &args[i * stride + argi];
+      if (callable->nonblocking)
+	callable_invoke (callable, state_lock, &args[i * stride + count],
+			 ffi_args);
+      else
+	ffi_call (&callable->cif, callable->address,
+		  &args[i * stride + count], ffi_args);
+    }
+  if (!callable->nonblocking)
+    lua_gobject_state_enter (state_lock);
+
+  if (!callable->has_retval)
+    return 0;
+
+  lua_createtable (L, n, 0);
+  for (i = 0; i < n; i++)
+    {
+      callable_param_2lua_op (L, &callable->retval, &args[i * stride + count],
+			      LUA_GOBJECT_PARENT_IS_RETVAL);
+      lua_rawseti (L, -2, i + 1);
+    }
+  return 1;
+}
+
+/* Invokes callable at stack index 1 n times, with arguments taken
+   either from row tables or from columns (see callable_batch_push()).
+   Results are returned column-wise, i.e. single table for each
+   returned value, indexed by the call number. */
+static int
+callable_batch (lua_State *L, int rows, int first, int ncols, int n)
+{
+  LuaGObjectState *state = lua_gobject_state_get (L);
+  Callable *callable = callable_check (L, state, 1);
+  int count = callable->has_self + callable->nargs;
+  int func, results, maxres = callable->nargs + 2, nres = 0, i, j;
+
+  luaL_checkstack (L, count + maxres + 4, "");
+  if (callable->is_scalar)
+    return callable_batch_scalar (L, callable, state->lock,
+				  rows, first, ncols, n);
+
+  /* Generic callables go through callable_call() for each set of
+     arguments, but without returning to Lua between the calls. */
+  callable_push_call (L, state);
+  func = lua_gettop (L);
+  results = func + 1;
+  for (j = 0; j < maxres; j++)
+    lua_pushnil (L);
+
+  for (i = 1; i <= n; i++)
+    {
+      int nret;
+      lua_pushvalue (L, func);
+      lua_pushvalue (L, 1);
+      callable_batch_push (L, rows, first, ncols, i, count);
+      lua_call (L, count + 1, LUA_MULTRET);
+
+      /* Store returned values into result columns. */
+      nret = lua_gettop (L) - (results + maxres - 1);
+      for (j = nret - 1; j >= 0; j--)
+	{
+	  if (lua_isnil (L, results + j))
+	    {
+	      lua_createtable (L, n, 0);
+	      lua_replace (L, results + j);
+	    }
+	  lua_rawseti (L, results + j, i);
+	}
+      if (nret > nres)
+	nres = nret;
+    }
+
+  lua_settop (L, results + nres - 1);
+  return nres;
+}
+
+/* Invokes the callable for every row of given array, each row being
+   table with arguments of one call.  Lua prototype:
+   res1, res2, ... = callable:map(rows) */
+static int
+callable_map (lua_State *L)
+{
+  luaL_checktype (L, 2, LUA_TTABLE);
+  return callable_batch (L, 2, 0, 0, lua_objlen (L, 2));
+}
+
+/* Invokes the callable n times, taking arguments from columns.  Lua
+   prototype:
+   res1, res2, ... = callable:call_many(n, col1, col2, ...) */
+static int
+callable_call_many (lua_State *L)
+{
+  int n = luaL_checkint (L, 2);
+  luaL_argcheck (L, n >= 0, 2, "negative count");
+  return callable_batch (L, 0, 3, lua_gettop (L) - 2, n);
+}
+
 static int
 callable_index (lua_State *L)
 {
@@ -1086,6 +2119,36 @@ callable_index (lua_State *L)
       lua_pushlightuserdata (L, callable->user_data);
       return 1;
     }
+  else if (g_strcmp0 (verb, "nonblocking") == 0)
+    {
+      lua_pushboolean (L, callable->nonblocking);
+      return 1;
+    }
+  else if (g_strcmp0 (verb, "intern_closures") == 0)
+    {
+      lua_pushboolean (L, callable->intern_closures);
+      return 1;
+    }
+  else if (g_strcmp0 (verb, "array_views") == 0)
+    {
+      lua_pushboolean (L, callable->array_views);
+      return 1;
+    }
+  else if (g_strcmp0 (verb, "lazy_containers") == 0)
+    {
+      lua_pushboolean (L, callable->lazy_containers);
+      return 1;
+    }
+  else if (g_strcmp0 (verb, "map") == 0)
+    {
+      lua_pushcfunction (L, callable_map);
+      return 1;
+    }
+  else if (g_strcmp0 (verb, "call_many") == 0)
+    {
+      lua_pushcfunction (L, callable_call_many);
+      return 1;
+    }
 
   return 0;
 }
@@ -1094,8 +2157,17 @@ static int
 callable_newindex (lua_State *L)
 {
   Callable *callable = callable_get (L, 1);
-  if (g_strcmp0 (lua_tostring (L, 2), "user_data") == 0)
+  const gchar *verb = lua_tostring (L, 2);
+  if (g_strcmp0 (verb, "user_data") == 0)
     callable->user_data = lua_touserdata (L, 3);
+  else if (g_strcmp0 (verb, "nonblocking") == 0)
+    callable->nonblocking = lua_toboolean (L, 3);
+  else if (g_strcmp0 (verb, "intern_closures") == 0)
+    callable->intern_closures = lua_toboolean (L, 3);
+  else if (g_strcmp0 (verb, "array_views") == 0)
+    callable->array_views = lua_toboolean (L, 3);
+  else if (g_strcmp0 (verb, "lazy_containers") == 0)
+    callable->lazy_containers = lua_toboolean (L, 3);
 
   return 0;
 }
@@ -1103,7 +2175,6 @@ callable_newindex (lua_State *L)
 static const struct luaL_Reg callable_reg[] = {
   { "__gc", callable_gc },
   { "__tostring", callable_tostring },
-  { "__call", callable_call },
   { "__index", callable_index },
   { "__newindex", callable_newindex },
   { NULL, NULL }
@@ -1118,18 +2189,15 @@ marshal_arguments (lua_State *L, void **args, int callable_index, Callable *call
   /* Marshall 'self' argument, if it is present. */
   if (callable->has_self)
     {
-      GIBaseInfo *parent = gi_base_info_get_container (GI_BASE_INFO (callable->info));
       gpointer addr = ((GIArgument*) args[0])->v_pointer;
       npos++;
-      if (GI_IS_OBJECT_INFO (parent) || GI_IS_INTERFACE_INFO (parent))
+      if (callable->self_kind == CALLABLE_SELF_OBJECT)
 	lua_gobject_object_2lua (L, addr, FALSE, FALSE);
-      else if (GI_IS_STRUCT_INFO (parent) || GI_IS_UNION_INFO (parent))
+      else
 	{
-	  lua_gobject_type_get_repotype (L, G_TYPE_INVALID, parent);
+	  callable_self_repotype (L, callable, callable_index);
 	  lua_gobject_record_2lua (L, addr, FALSE, 0);
 	}
-      else
-	g_assert_not_reached ();
     }
 
   /* Marshal input arguments to lua. */
@@ -1179,7 +2247,6 @@ static void
 marshal_return_values (lua_State *L, void *ret, void **args, int callable_index, Callable *callable, int npos)
 {
   int to_pop, i;
-  GITypeTag tag;
   Param *param;
 
   /* Make sure that all unspecified returns and outputs are set as
@@ -1189,9 +2256,7 @@ marshal_return_values (lua_State *L, void *ret, void **args, int callable_index,
   lua_settop(L, lua_gettop (L) + callable->has_self + callable->nargs + 1);
 
   /* Marshal return value from Lua. */
-  tag = gi_type_info_get_tag (callable->retval.ti);
-  if (tag != GI_TYPE_TAG_VOID
-      || gi_type_info_is_pointer (callable->retval.ti))
+  if (callable->has_retval)
     {
       if (callable->ignore_retval)
 	/* Return value should be ignored on Lua side, so we have
@@ -1203,7 +2268,7 @@ marshal_return_values (lua_State *L, void *ret, void **args, int callable_index,
 	  to_pop = callable_param_2c (L, &callable->retval, npos,
 				      LUA_GOBJECT_PARENT_IS_RETVAL, ret,
 				      callable_index, callable,
-				      args + callable->has_self);
+				      args + callable->has_self, FALSE);
 	  if (to_pop != 0)
 	    {
 	      g_warning ("cbk `%s.%s': return (transfer none) %d, unsafe!",
@@ -1223,12 +2288,11 @@ marshal_return_values (lua_State *L, void *ret, void **args, int callable_index,
       {
 	gpointer *arg = args[i + callable->has_self];
 	gboolean caller_alloc =
-	  callable->info && gi_arg_info_is_caller_allocates (&param->ai)
-	  && gi_type_info_get_tag (param->ti) == GI_TYPE_TAG_INTERFACE;
+	  param->caller_alloc && param->tag == GI_TYPE_TAG_INTERFACE;
 	to_pop = callable_param_2c (L, param, npos, caller_alloc
 				    ? LUA_GOBJECT_PARENT_CALLER_ALLOC : 0, *arg,
 				    callable_index, callable,
-				    args + callable->has_self);
+				    args + callable->has_self, FALSE);
 	if (to_pop != 0)
 	  {
 	    g_warning ("cbk %s.%s: arg `%s' (transfer none) %d, unsafe!",
@@ -1242,6 +2306,26 @@ marshal_return_values (lua_State *L, void *ret, void **args, int callable_index,
       }
 }
 
+/* Return slots of the callback, passed to marshal_return_values_call()
+   as lightuserdata. */
+typedef struct _ReturnSlots
+{
+  void *ret;
+  void **args;
+  Callable *callable;
+} ReturnSlots;
+
+/* Protected entry of marshal_return_values(); expects callable at
+   index 1, returned values after it and ReturnSlots at the top. */
+static int
+marshal_return_values_call (lua_State *L)
+{
+  ReturnSlots *slots = lua_touserdata (L, -1);
+  lua_pop (L, 1);
+  marshal_return_values (L, slots->ret, slots->args, 1, slots->callable, 2);
+  return 0;
+}
+
 static void
 marshal_return_error (lua_State *L, void *ret, void **args, Callable *callable)
 {
@@ -1262,10 +2346,36 @@ marshal_return_error (lua_State *L, void *ret, void **args, Callable *callable)
       }
 
     /* Such function should usually return FALSE, so do it. */
-    if (gi_type_info_get_tag (callable->retval.ti) == GI_TYPE_TAG_BOOLEAN)
+    if (callable->retval.tag == GI_TYPE_TAG_BOOLEAN)
       *(gboolean *) ret = FALSE;
 }
 
+/* Returns threads borrowed from the pool by closure_callback(). */
+static void
+closure_callback_release (LuaGObjectState *state, lua_State *L,
+			  lua_State *marshal_L, lua_State *pooled_L)
+{
+  if (L != marshal_L)
+    lua_gobject_callback_thread_release (state, marshal_L);
+  if (pooled_L != NULL)
+    lua_gobject_callback_thread_release (state, pooled_L);
+}
+
+/* Reports error at the top of the stack raised by the callback, which
+   cannot be rethrown because the thread which would get it is
+   suspended, and makes the callback return zero instead. */
+static void
+closure_callback_warn (lua_State *L, Callable *callable, FfiClosure *closure,
+		       ffi_cif *cif, void *ret)
+{
+  callable_describe (L, callable, closure);
+  g_warning ("Error raised while calling '%s': %s",
+	     lua_tostring (L, -1), lua_tostring (L, -2));
+  lua_pop (L, 2);
+  if (cif->rtype->type != FFI_TYPE_VOID)
+    memset (ret, 0, MAX (cif->rtype->size, sizeof (ffi_arg)));
+}
+
 /* Closure callback, called by libffi when C code wants to invoke Lua
    callback. */
 static void
@@ -1277,45 +2387,65 @@ closure_callback (ffi_cif *cif, void *ret, void **args, void *closure_arg)
   FfiClosureBlock *block = closure->block;
   gint res = 0, npos, stacktop, extra_args = 0;
   gboolean call;
-  lua_State *L;
-  lua_State *marshal_L;
-  (void)cif;
+  lua_State *L, *pooled_L = NULL;
+  lua_State *marshal_L, *block_L;
+  LuaGObjectState *state = block->callback.state;
+  int refs;
+
+  /* Callback invoked from inside nonblocking call means that the
+     nonblocking policy was applied to wrong function. */
+  if (G_UNLIKELY (g_atomic_int_get (&nonblocking_check))
+      && g_private_get (&nonblocking_call))
+    {
+      Callable *outer = g_private_get (&nonblocking_call);
+      g_atomic_int_inc (&nonblocking_violations);
+      g_critical ("callback invoked during nonblocking call of `%s'",
+		  outer->info ? gi_base_info_get_name (GI_BASE_INFO (outer->info))
+		  : "(parsed)");
+    }
 
-  /* Get access to proper Lua context. */
-  lua_gobject_state_enter (block->callback.state_lock);
-  lua_rawgeti (block->callback.L, LUA_REGISTRYINDEX, block->callback.thread_ref);
-  L = lua_tothread (block->callback.L, -1);
+  /* Get access to proper Lua context.  Callable, target and thread of
+     the closure are fetched at once, so that the table of the closure
+     store is looked up only once for each callback. */
+  lua_gobject_state_enter (state->lock);
+  block_L = block->callback.L;
+  lua_gobject_state_push (block_L, state, closure_refs);
+  refs = lua_gettop (block_L);
+  lua_rawgeti (block_L, refs, closure->callable_ref);
+  callable = lua_touserdata (block_L, -1);
   call = (closure->target_ref != LUA_NOREF);
+  if (call)
+    lua_rawgeti (block_L, refs, closure->target_ref);
+  lua_rawgeti (block_L, refs, block->callback.thread_ref);
+  L = lua_tothread (block_L, -1);
+  lua_pop (block_L, 1);
+  lua_remove (block_L, refs);
   if (call)
     {
       /* We will call target method, prepare context/thread to do
 	 it. */
       if (lua_status (L) != 0)
-	{
-	  /* Thread is not in usable state for us, it is suspended, we
-	     cannot afford to resume it, because it is possible that
-	     the routine we are about to call is actually going to
-	     resume it.  Create new thread instead and switch closure
-	     to its context. */
-	  lua_State *newL = lua_newthread (L);
-	  lua_rawseti (L, LUA_REGISTRYINDEX, block->callback.thread_ref);
-	  L = newL;
-	}
-      lua_pop (block->callback.L, 1);
-      block->callback.L = L;
-
-      /* Remember stacktop, this is the position on which we should
-	 expect return values (note that callback_prepare_call already
-	 might have pushed function to be executed to the stack). */
-      stacktop = lua_gettop (L);
-
-      /* Store function to be invoked to the stack. */
-      lua_rawgeti (L, LUA_REGISTRYINDEX, closure->target_ref);
+	/* Thread is not in usable state for us, it is suspended, we
+	   cannot afford to resume it, because it is possible that
+	   the routine we are about to call is actually going to
+	   resume it.  Borrow a thread from the pool instead. */
+	L = pooled_L = lua_gobject_callback_thread_acquire (block_L,
+							    state);
+      else
+	block->callback.L = L;
+
+      /* Move callable and function to be invoked to the stack.
+	 Remember stacktop, this is the position on which we should
+	 expect callable followed by return values (note that
+	 callback_prepare_call already might have pushed function to
+	 be executed to the stack). */
+      lua_xmove (block_L, L, 2);
+      stacktop = lua_gettop (L) - 2;
+      callable_index = stacktop + 1;
+      marshal_L = L;
     }
   else
     {
-      /* Cleanup the stack of the original thread. */
-      lua_pop (block->callback.L, 1);
       stacktop = lua_gettop (L);
       if (lua_status (L) == 0)
 	{
@@ -1324,34 +2454,26 @@ closure_callback (ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	  stacktop--;
 	  extra_args++;
 	}
-    }
 
-  /* Pick a coroutine used for marshalling */
-  marshal_L = L;
-  if (lua_status (marshal_L) == LUA_YIELD)
-    {
-      lua_pushlightuserdata (L, &marshalling_L_address);
-      lua_rawget (L, LUA_REGISTRYINDEX);
-      marshal_L = lua_tothread (L, -1);
-      lua_pop (L, 1);
-      g_assert (lua_gettop (marshal_L) == 0);
+      /* Pick a coroutine used for marshalling; suspended coroutine
+	 cannot be used, so borrow a thread from the pool. */
+      marshal_L = L;
+      if (lua_status (marshal_L) == LUA_YIELD)
+	marshal_L = lua_gobject_callback_thread_acquire (L, state);
+      lua_xmove (block_L, marshal_L, 1);
+      callable_index = lua_gettop (marshal_L);
     }
 
-  /* Get access to Callable structure. */
-  lua_rawgeti (marshal_L, LUA_REGISTRYINDEX, closure->callable_ref);
-  callable = lua_touserdata (marshal_L, -1);
-  callable_index = lua_gettop (marshal_L);
-
   npos = marshal_arguments (marshal_L, args, callable_index, callable);
 
-  /* Remove callable userdata from callable_index, otherwise they mess
-     up carefully prepared stack structure. */
-  lua_remove (marshal_L, callable_index);
+  /* Callable stays below function and its arguments, so that it
+     precedes returned values.  Coroutine which is not started yet
+     would get it as its argument, so remove it there. */
+  if (!call && L == marshal_L)
+    lua_remove (marshal_L, callable_index);
 
   /* Call it. */
   lua_xmove (marshal_L, L, npos + extra_args);
-  if (L != marshal_L)
-      g_assert (lua_gettop (marshal_L) == 0);
   if (call)
     {
       if (callable->throws)
@@ -1379,13 +2501,20 @@ closure_callback (ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	/* For our purposes is YIELD the same as if the coro really
 	   returned. */
 	res = 0;
-      else if (res == LUA_ERRRUN && !callable->throws)
+      else if (res != 0 && !callable->throws)
 	{
 	  /* If closure is not allowed to return errors and coroutine
 	     finished with error, rethrow the error in the context of
-	     the original thread. */
-	  lua_xmove (L, block->callback.L, 1);
-	  lua_error (block->callback.L);
+	     the original thread.  Suspended thread cannot get it, so
+	     only report it then. */
+	  if (lua_status (block->callback.L) == 0)
+	    {
+	      lua_xmove (L, block->callback.L, 1);
+	      closure_callback_release (state, L, marshal_L, pooled_L);
+	      lua_error (block->callback.L);
+	    }
+	  lua_xmove (L, marshal_L, 1);
+	  closure_callback_warn (marshal_L, callable, closure, cif, ret);
 	}
 
       /* If coroutine somehow consumed more than expected(?), do not
@@ -1394,19 +2523,50 @@ closure_callback (ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	stacktop = lua_gettop (L);
     }
 
-  lua_xmove (L, marshal_L, lua_gettop(L) - stacktop);
-
-  /* Reintroduce callable to the stack, we might need it during
-     marshalling of the response. Put it right before all returns. */
-  lua_rawgeti (marshal_L, LUA_REGISTRYINDEX, closure->callable_ref);
-  lua_insert (marshal_L, stacktop + 1);
-  callable_index = stacktop + 1;
-  npos = stacktop + 2;
+  /* Move returned values to the marshalling thread, right after the
+     callable, we need it during marshalling of the response.  Only
+     started coroutine needs it to be reintroduced. */
+  if (call)
+    npos = stacktop + 2;
+  else
+    {
+      lua_xmove (L, marshal_L, lua_gettop (L) - stacktop);
+      if (L == marshal_L)
+	{
+	  closure_get (marshal_L, state, closure->callable_ref);
+	  lua_insert (marshal_L, stacktop + 1);
+	  callable_index = stacktop + 1;
+	}
+      npos = callable_index + 1;
+    }
 
   /* Check, whether we can report an error here. */
-  if (res == 0)
+  if (res == 0 && L == marshal_L && pooled_L == NULL)
     marshal_return_values (marshal_L, ret, args, callable_index, callable, npos);
-  else
+  else if (res == 0)
+    {
+      /* Marshalling errors would leak borrowed threads, so catch
+	 them, give the threads back and rethrow the error in the
+	 context of the original thread.  When the callback runs on a
+	 borrowed thread because the original one is suspended, only
+	 report the error. */
+      ReturnSlots slots = { ret, args, callable };
+      lua_pushcfunction (marshal_L, marshal_return_values_call);
+      lua_insert (marshal_L, callable_index);
+      lua_pushlightuserdata (marshal_L, &slots);
+      if (lua_pcall (marshal_L, lua_gettop (marshal_L) - callable_index,
+		     0, 0) != 0)
+	{
+	  if (pooled_L == NULL && lua_status (block->callback.L) == 0)
+	    {
+	      lua_xmove (marshal_L, block->callback.L, 1);
+	      closure_callback_release (state, L, marshal_L, pooled_L);
+	      lua_error (block->callback.L);
+	    }
+	  closure_callback_warn (marshal_L, callable, closure, cif, ret);
+	}
+    }
+  else if (callable->throws)
     marshal_return_error (marshal_L, ret, args, callable);
 
   /* If the closure is marked as autodestroy, destroy it now.  Note that it is
@@ -1419,11 +2579,10 @@ closure_callback (ffi_cif *cif, void *ret, void **args, void *closure_arg)
   /* This is NOT called by Lua, so we better leave the Lua stack we
      used pretty much tidied. */
   lua_settop (L, stacktop);
-  if (L != marshal_L)
-    lua_settop (marshal_L, 0);
+  closure_callback_release (state, L, marshal_L, pooled_L);
 
   /* Going back to C code, release the state synchronization. */
-  lua_gobject_state_leave (block->callback.state_lock);
+  lua_gobject_state_leave (block->callback.state->lock);
 }
 
 /* Destroys specified closure. */
@@ -1432,19 +2591,46 @@ lua_gobject_closure_destroy (gpointer user_data)
 {
   FfiClosureBlock* block = user_data;
   lua_State *L = block->callback.L;
+  LuaGObjectState *state = block->callback.state;
   FfiClosure *closure;
   int i;
 
+  /* Interned block is destroyed only by its last owner. */
+  if (--block->ref_count > 0)
+    return;
+
+  if (block->interned)
+    {
+      /* Remove the block from the table of interned blocks, and the
+	 table of the target when it becomes empty. */
+      lua_gobject_state_push (L, state, closure_interned);
+      closure_get (L, state, block->ffi_closure.target_ref);
+      lua_pushvalue (L, -1);
+      lua_rawget (L, -3);
+      lua_pushlightuserdata (L, block->ffi_closure.prepared);
+      lua_pushnil (L);
+      lua_rawset (L, -3);
+      lua_pushnil (L);
+      if (lua_next (L, -2))
+	lua_pop (L, 5);
+      else
+	{
+	  lua_pop (L, 1);
+	  lua_pushnil (L);
+	  lua_rawset (L, -3);
+	  lua_pop (L, 1);
+	}
+    }
+
   for (i = block->closures_count - 1; i >= -1; --i)
     {
       closure = (i < 0) ? &block->ffi_closure : block->ffi_closures[i];
       if (closure->created)
-	{
-	  luaL_unref (L, LUA_REGISTRYINDEX, closure->callable_ref);
-	  luaL_unref (L, LUA_REGISTRYINDEX, closure->target_ref);
-	}
+	lua_gobject_closure_unref (L, state, closure->target_ref);
+      if (closure->prepared != NULL)
+	lua_gobject_closure_unref (L, state, closure->callable_ref);
       if (i < 0)
-	luaL_unref (L, LUA_REGISTRYINDEX, block->callback.thread_ref);
+	lua_gobject_closure_unref (L, state, block->callback.thread_ref);
       ffi_closure_free (closure);
     }
 }
@@ -1456,15 +2642,31 @@ lua_gobject_closure_allocate (lua_State *L, int count)
 {
   gpointer call_addr;
   int i;
+  FfiClosureBlock *block;
+  LuaGObjectState *state = lua_gobject_state_get (L);
+  ClosureStore *store = state->closure_store;
+
+  /* Reuse pooled block, if possible. */
+  if (count == 1 && store->n_pooled > 0)
+    {
+      block = store->pooled[--store->n_pooled];
+      block->ref_count = 1;
+      block->callback.L = L;
+      lua_pushthread (L);
+      closure_set (L, state, block->callback.thread_ref);
+      return block;
+    }
 
   /* Allocate header block. */
-  FfiClosureBlock *block =
-    ffi_closure_alloc (offsetof (FfiClosureBlock, ffi_closures)
-		       + (--count * sizeof (FfiClosure*)), &call_addr);
+  block = ffi_closure_alloc (offsetof (FfiClosureBlock, ffi_closures)
+			     + (--count * sizeof (FfiClosure*)), &call_addr);
   block->ffi_closure.created = 0;
   block->ffi_closure.call_addr = call_addr;
+  block->ffi_closure.prepared = NULL;
   block->ffi_closure.block = block;
   block->closures_count = count;
+  block->ref_count = 1;
+  block->interned = FALSE;
 
   /* Allocate all additional closures. */
   for (i = 0; i < count; ++i)
@@ -1473,30 +2675,86 @@ lua_gobject_closure_allocate (lua_State *L, int count)
 						  &call_addr);
       block->ffi_closures[i]->created = 0;
       block->ffi_closures[i]->call_addr = call_addr;
+      block->ffi_closures[i]->prepared = NULL;
       block->ffi_closures[i]->block = block;
     }
 
   /* Store reference to target Lua thread. */
   block->callback.L = L;
   lua_pushthread (L);
-  block->callback.thread_ref = luaL_ref (L, LUA_REGISTRYINDEX);
+  block->callback.thread_ref = lua_gobject_closure_ref (L, state);
 
-  /* Retrieve and remember state lock. */
-  block->callback.state_lock = lua_gobject_state_get_lock (L);
+  /* Remember per-state block, containing state lock. */
+  block->callback.state = state;
   return block;
 }
 
+/* Releases closure block of scope=call closure.  Single-closure
+   blocks are returned to the pool, keeping their prepared closure
+   code, other blocks are destroyed. */
+void
+lua_gobject_closure_release (gpointer user_data)
+{
+  FfiClosureBlock *block = user_data;
+  LuaGObjectState *state = block->callback.state;
+  ClosureStore *store = state->closure_store;
+  FfiClosure *closure = &block->ffi_closure;
+  lua_State *L = block->callback.L;
+
+  if (block->closures_count > 0 || store->n_pooled == CLOSURE_POOL_SIZE
+      || store->closed)
+    {
+      lua_gobject_closure_destroy (block);
+      return;
+    }
+
+  /* Drop references to the target and its thread, so that they can
+     be collected while the block is pooled. */
+  if (closure->created)
+    lua_gobject_closure_unref (L, state, closure->target_ref);
+  closure->created = 0;
+  lua_pushboolean (L, 0);
+  closure_set (L, state, block->callback.thread_ref);
+  block->callback.L = NULL;
+  store->pooled[store->n_pooled++] = block;
+}
+
+/* Frees all pooled blocks and the list of free slots when the state
+   is closed.  Closures destroyed by finalizers running later do not
+   release their slots anymore, the table is going away anyway. */
+static int
+closure_store_gc (lua_State *L)
+{
+  ClosureStore *store = lua_touserdata (L, 1);
+  while (store->n_pooled > 0)
+    ffi_closure_free (store->pooled[--store->n_pooled]);
+  g_free (store->free);
+  store->free = NULL;
+  store->n_free = store->free_size = 0;
+  store->closed = TRUE;
+  return 0;
+}
+
 /* Creates closure from Lua function to be passed to C. */
 gpointer
 lua_gobject_closure_create (lua_State *L, gpointer user_data,
 		    int target, gboolean autodestroy)
 {
   FfiClosureBlock* block = user_data;
+  LuaGObjectState *state = block->callback.state;
   FfiClosure *closure;
   Callable *callable;
   gpointer call_addr;
   int i;
 
+  /* Block found by callable_intern_lookup() has its closure already
+     prepared and created for the same target and callable. */
+  if (block->interned)
+    {
+      lua_pop (L, 1);
+      return block->ffi_closure.call_addr;
+    }
+
   /* Find pointer to target FfiClosure. */
   for (closure = &block->ffi_closure, i = 0; closure->created; ++i)
     {
@@ -1504,34 +2762,44 @@ lua_gobject_closure_create (lua_State *L, gpointer user_data,
       closure = block->ffi_closures[i];
     }
 
-  /* Prepare callable and store reference to it. */
+  /* Prepare callable and store reference to it, unless the closure
+     comes from the pool already prepared for the same callable. */
   callable = lua_touserdata (L, -1);
   call_addr = closure->call_addr;
+  if (closure->prepared == callable)
+    lua_pop (L, 1);
+  else
+    {
+      if (closure->prepared != NULL)
+	lua_gobject_closure_unref (L, state, closure->callable_ref);
+      closure->prepared = NULL;
+      closure->callable_ref = lua_gobject_closure_ref (L, state);
+      if (ffi_prep_closure_loc (&closure->ffi_closure, &callable->cif,
+				closure_callback, closure, call_addr) != FFI_OK)
+	{
+	  lua_gobject_closure_unref (L, state, closure->callable_ref);
+	  lua_concat (L, lua_gobject_type_get_name (L, GI_BASE_INFO (callable->info)));
+	  luaL_error (L, "failed to prepare closure for `%'", lua_tostring (L, -1));
+	  return NULL;
+	}
+      closure->prepared = callable;
+    }
+
   closure->created = 1;
   closure->autodestroy = autodestroy;
-  closure->callable_ref = luaL_ref (L, LUA_REGISTRYINDEX);
   if (!lua_isthread (L, target))
     {
       lua_pushvalue (L, target);
-      closure->target_ref = luaL_ref (L, LUA_REGISTRYINDEX);
+      closure->target_ref = lua_gobject_closure_ref (L, state);
     }
   else
     {
       /* Switch thread_ref to actual target thread. */
       lua_pushvalue (L, target);
-      lua_rawseti (L, LUA_REGISTRYINDEX, block->callback.thread_ref);
+      closure_set (L, state, block->callback.thread_ref);
       closure->target_ref = LUA_NOREF;
     }
 
-  /* Create closure. */
-  if (ffi_prep_closure_loc (&closure->ffi_closure, &callable->cif,
-			    closure_callback, closure, call_addr) != FFI_OK)
-    {
-      lua_concat (L, lua_gobject_type_get_name (L, GI_BASE_INFO (callable->info)));
-      luaL_error (L, "failed to prepare closure for `%'", lua_tostring (L, -1));
-      return NULL;
-    }
-
   return call_addr;
 }
 
@@ -1550,29 +2818,119 @@ callable_new (lua_State *L)
 				  addr);
 }
 
+/* Sets nonblocking policy for the namespace. Lua prototype:
+   callable.nonblocking(namespace, true|false|prefix) */
+static int
+callable_set_nonblocking (lua_State *L)
+{
+  luaL_checkstring (L, 1);
+  lua_pushlightuserdata (L, &callable_nonblocking);
+  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_pushvalue (L, 1);
+  if (lua_type (L, 2) == LUA_TSTRING)
+    lua_pushvalue (L, 2);
+  else if (lua_toboolean (L, 2))
+    lua_pushboolean (L, 1);
+  else
+    lua_pushnil (L);
+  lua_rawset (L, -3);
+  return 0;
+}
+
+/* Enables or disables checking for callbacks invoked during
+   nonblocking calls, returns number of such callbacks detected since
+   the previous call.  Lua prototype:
+   count = callable.nonblocking_check(enabled) */
+static int
+callable_set_nonblocking_check (lua_State *L)
+{
+  gint count = g_atomic_int_get (&nonblocking_violations);
+  g_atomic_int_add (&nonblocking_violations, -count);
+  g_atomic_int_set (&nonblocking_check, lua_toboolean (L, 1));
+  lua_pushinteger (L, count);
+  return 1;
+}
+
+/* Returns array with addresses (as lightuserdata) of closure blocks
+   interned for given Lua target, one for each callback type.  Lua
+   prototype:
+   blocks = callable.interned(target) */
+static int
+callable_interned (lua_State *L)
+{
+  LuaGObjectState *state = lua_gobject_state_get (L);
+  int n = 0;
+  luaL_checkany (L, 1);
+  lua_settop (L, 1);
+  lua_newtable (L);
+  lua_gobject_state_push (L, state, closure_interned);
+  lua_pushvalue (L, 1);
+  lua_rawget (L, -2);
+  if (lua_istable (L, -1))
+    {
+      lua_pushnil (L);
+      while (lua_next (L, -2))
+	lua_rawseti (L, 2, ++n);
+    }
+  lua_settop (L, 2);
+  return 1;
+}
+
 /* Callable module public API table. */
 static const luaL_Reg callable_api_reg[] = {
   { "new", callable_new },
+  { "nonblocking", callable_set_nonblocking },
+  { "nonblocking_check", callable_set_nonblocking_check },
+  { "interned", callable_interned },
   { NULL, NULL }
 };
 
 void
 lua_gobject_callable_init (lua_State *L)
 {
-  /* Create a thread for marshalling arguments to yielded threads, register it
-   * so that it is not GC'd. */
-  lua_pushlightuserdata (L, &marshalling_L_address);
-  lua_newthread (L);
-  lua_rawset (L, LUA_REGISTRYINDEX);
+  LuaGObjectState *state = lua_gobject_state_get (L);
+  ClosureStore *store;
 
-  /* Register callable metatable. */
-  lua_pushlightuserdata (L, &callable_mt);
+  /* Register callable metatable.  __call gets per-state block as an
+     upvalue. */
   lua_newtable (L);
   luaL_register (L, NULL, callable_reg);
-  lua_rawset (L, LUA_REGISTRYINDEX);
+  callable_push_call (L, state);
+  lua_setfield (L, -2, "__call");
+  state->callable_mt = luaL_ref (L, LUA_REGISTRYINDEX);
 
   /* Create cache for callables. */
-  lua_gobject_cache_create (L, &callable_cache, NULL);
+  lua_pushlightuserdata (L, &callable_cache);
+  lua_gobject_cache_create (L, NULL);
+  lua_rawset (L, LUA_REGISTRYINDEX);
+
+  /* Create closure store, anchored in the registry, and the table
+     with values referenced by closures. */
+  luaL_newmetatable (L, UD_CLOSURE_STORE);
+  lua_pushcfunction (L, closure_store_gc);
+  lua_setfield (L, -2, "__gc");
+  lua_pop (L, 1);
+  lua_pushlightuserdata (L, &closure_store);
+  store = lua_newuserdata (L, sizeof (ClosureStore));
+  memset (store, 0, sizeof (ClosureStore));
+  luaL_getmetatable (L, UD_CLOSURE_STORE);
+  lua_setmetatable (L, -2);
+  lua_rawset (L, LUA_REGISTRYINDEX);
+  state->closure_store = store;
+  lua_newtable (L);
+  state->closure_refs = luaL_ref (L, LUA_REGISTRYINDEX);
+  lua_newtable (L);
+  state->closure_interned = luaL_ref (L, LUA_REGISTRYINDEX);
+
+  /* Create pool of threads for callbacks arriving while their thread
+     is suspended. */
+  lua_newtable (L);
+  state->callback_threads = luaL_ref (L, LUA_REGISTRYINDEX);
+
+  /* Create table with nonblocking policy. */
+  lua_pushlightuserdata (L, &callable_nonblocking);
+  lua_newtable (L);
+  lua_rawset (L, LUA_REGISTRYINDEX);
 
   /* Create public api for callable module. */
   lua_newtable (L);
@@ -134,19 +134,20 @@ function class.class_mt:_element(instance, symbol)
    if instance and internals[symbol] then return symbol, symbol end
 
    -- Check default implementation.
-   local element, category = component.mt._element(self, instance, symbol)
-   if element then return element, category end
+   local element, category, owner =
+      component.mt._element(self, instance, symbol)
+   if element then return element, category, owner end
 
    -- Check parent and all implemented interfaces.
    local parent = rawget(self, '_parent')
    if parent then
-      element, category = parent:_element(instance, symbol)
-      if element then return element, category end
+      element, category, owner = parent:_element(instance, symbol)
+      if element then return element, category, owner end
    end
    local implements = rawget(self, '_implements') or {}
    for _, implemented in pairs(implements or {}) do
-      element, category = implemented:_element(instance, symbol, self)
-      if element then return element, category end
+      element, category, owner = implemented:_element(instance, symbol, self)
+      if element then return element, category, owner end
    end
 end
 
@@ -401,8 +402,7 @@ function class.derived_mt:_element(instance, symbol)
    if instance and symbol == 'priv' then return symbol, '_priv' end
 
    -- Check default implementation.
-   local element, category = class.class_mt._element(self, instance, symbol)
-   if element then return element, category end
+   return class.class_mt._element(self, instance, symbol)
 end
 
 function class.derived_mt:_access_priv(instance, name, ...)
@@ -442,6 +442,7 @@ function class.derived_mt:__newindex(name, target)
       -- Simply assign to type.  This most probably means adding new
       -- member function to the class (or some static member).
       rawset(self, name, target)
+      core.object.invalidate(self, name)
    end
 end
 
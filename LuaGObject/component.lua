@@ -184,8 +184,11 @@ local keyword_dictionary = {
    _true = 'true', _and = 'and', _or = 'or', _not = 'not',
 }
 
--- Retrieves (element, category) pair from given componenttable and
--- instance for given symbol.
+-- Retrieves (element, category, owner) triplet from given
+-- componenttable and instance for given symbol.  Owner is the
+-- componenttable in which the element was found; it is returned only
+-- for elements which do not depend on the instance, so that the core
+-- can cache them.
 function component.mt:_element(instance, symbol, origin)
    -- This generic version can work only with strings.  Refuse
    -- everything other, hoping that some more specialized _element
@@ -198,14 +201,14 @@ function component.mt:_element(instance, symbol, origin)
 
    -- Check whether symbol is directly accessible in the component.
    local element = rawget(self, symbol)
-   if element then return element end
+   if element then return element, nil, self end
 
    -- Check whether symbol is accessible in cached directory of the
    -- component, packed as element value and category
    local cached = rawget(self, '_cached')
    if cached then
       element = cached[symbol]
-      if element then return element[1], element[2] end
+      if element then return element[1], element[2], self end
    end
 
    -- Decompose symbol name, in case that it contains category prefix
@@ -239,21 +242,30 @@ function component.mt:_element(instance, symbol, origin)
 	 -- No category or no special category handler is present,
 	 -- store it directly, which results in fastest access.  This
 	 -- is most typical for methods.
-	 self[symbol] = element
+	 rawset(self, symbol, element)
       else
 	 -- Store into _cached table, because we have to preserve the
 	 -- category.
 	 if not cached then
 	    cached = {}
-	    self._cached = cached
+	    rawset(self, '_cached', cached)
 	 end
 	 cached[symbol] = { element, category }
       end
 
-      return element, category
+      return element, category, self
    end
 end
 
+-- __newindex implementation, invalidates elements cached by the core
+-- for object access and compiled record fields, because new member
+-- might shadow them.
+function component.mt:__newindex(key, value)
+   rawset(self, key, value)
+   rawset(self, '_fielddesc', nil)
+   core.object.invalidate(self, key)
+end
+
 -- __index implementation, uses _element method to perform lookup.
 function component.mt:__index(key)
    -- First try to invoke our own _element method.
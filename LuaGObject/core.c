@@ -105,9 +105,8 @@ lua_gobject_udata_test (lua_State *L, int narg, const char *name)
 }
 
 void
-lua_gobject_cache_create (lua_State *L, gpointer key, const char *mode)
+lua_gobject_cache_create (lua_State *L, const char *mode)
 {
-  lua_pushlightuserdata (L, key);
   lua_newtable (L);
   if (mode)
     {
@@ -116,7 +115,6 @@ lua_gobject_cache_create (lua_State *L, gpointer key, const char *mode)
       lua_setfield (L, -2, "__mode");
       lua_setmetatable (L, -2);
     }
-  lua_rawset (L, LUA_REGISTRYINDEX);
 }
 
 int
@@ -310,6 +308,9 @@ typedef struct _LgiStateMutex
      structure) or to global package lock. */
   GRecMutex *mutex;
   GRecMutex state_mutex;
+
+  /* Per-state block, handed out by lua_gobject_state_get(). */
+  LuaGObjectState state;
 } LgiStateMutex;
 
 /* Global package lock (the one used for
@@ -338,12 +339,239 @@ lua_gobject_state_get_lock (lua_State *L)
 {
   gpointer state_lock;
   lua_pushlightuserdata (L, &call_mutex);
-  lua_gettable (L, LUA_REGISTRYINDEX);
+  lua_rawget (L, LUA_REGISTRYINDEX);
   state_lock = lua_touserdata (L, -1);
   lua_pop (L, 1);
   return state_lock;
 }
 
+LuaGObjectState *
+lua_gobject_state_get (lua_State *L)
+{
+  LgiStateMutex *mutex = lua_gobject_state_get_lock (L);
+  return &mutex->state;
+}
+
+void
+lua_gobject_state_register (lua_State *L, LuaGObjectState *state,
+			    const luaL_Reg *reg)
+{
+  luaL_checkstack (L, 2, "");
+  for (; reg->name != NULL; reg++)
+    {
+      lua_pushlightuserdata (L, state);
+      lua_pushcclosure (L, reg->func, 1);
+      lua_setfield (L, -2, reg->name);
+    }
+}
+
+/* Size of the memory block embedded in the arena itself, and of
+   minimal overflow chunk allocated on the heap. */
+#define ARENA_BLOCK_SIZE 512
+
+/* Rounds size up to the alignment of arena allocations. */
+#define ARENA_ALIGN(size)					\
+  (((size) + G_MEM_ALIGN - 1) & ~((gsize) G_MEM_ALIGN - 1))
+
+/* Destroy handler registered for single temporary; the same
+   semantics as Guard. */
+typedef struct _ArenaCleanup
+{
+  struct _ArenaCleanup *next;
+  gpointer data;
+  GDestroyNotify destroy;
+} ArenaCleanup;
+
+/* Heap chunk used when the embedded block is exhausted.  Its memory
+   follows the (aligned) header. */
+typedef struct _ArenaChunk
+{
+  struct _ArenaChunk *next;
+} ArenaChunk;
+
+typedef struct _Arena
+{
+  /* Per-state block of the state owning the arena. */
+  LuaGObjectState *state;
+
+  /* Arena which was current when this one was opened, made current
+     again when this one is closed. */
+  struct _Arena *outer;
+
+  /* Registered cleanups, most recent first. */
+  ArenaCleanup *cleanups;
+
+  /* Overflow chunks and free space in the current block. */
+  ArenaChunk *chunks;
+  gchar *pos, *end;
+
+  /* Embedded block, aligned for any arena allocation. */
+  union
+  {
+    gchar data[ARENA_BLOCK_SIZE];
+    gdouble d;
+    gint64 i;
+    gpointer p;
+  } block;
+} Arena;
+#define UD_ARENA "lua_gobject.arena"
+
+/* Allocates uninitialized memory from the arena. */
+static gpointer
+arena_alloc (Arena *arena, gsize size)
+{
+  gpointer mem;
+  size = ARENA_ALIGN (size);
+  if (size > (gsize) (arena->end - arena->pos))
+    {
+      gsize header = ARENA_ALIGN (sizeof (ArenaChunk));
+      gsize chunk_size = MAX (size, ARENA_BLOCK_SIZE);
+      ArenaChunk *chunk = g_malloc (header + chunk_size);
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+      arena->pos = (gchar *) chunk + header;
+      arena->end = arena->pos + chunk_size;
+    }
+
+  mem = arena->pos;
+  arena->pos += size;
+  return mem;
+}
+
+/* Runs all cleanups in reverse order of their registration and frees
+   all memory, leaving the arena empty and ready for reuse. */
+static void
+arena_release (Arena *arena)
+{
+  while (arena->cleanups != NULL)
+    {
+      ArenaCleanup *cleanup = arena->cleanups;
+      arena->cleanups = cleanup->next;
+      if (cleanup->data != NULL)
+	cleanup->destroy (cleanup->data);
+    }
+
+  while (arena->chunks != NULL)
+    {
+      ArenaChunk *chunk = arena->chunks;
+      arena->chunks = chunk->next;
+      g_free (chunk);
+    }
+
+  arena->pos = arena->block.data;
+  arena->end = arena->pos + ARENA_BLOCK_SIZE;
+}
+
+/* Releases the arena when it is collected.  Arena abandoned by an
+   error raised during its call can still be linked from the chain of
+   current arenas, so unlink it first. */
+static int
+arena_gc (lua_State *L)
+{
+  Arena *arena = lua_touserdata (L, 1), **link;
+  for (link = (Arena **) &arena->state->arena; *link != NULL;
+       link = &(*link)->outer)
+    if (*link == arena)
+      {
+	*link = arena->outer;
+	break;
+      }
+
+  arena_release (arena);
+  return 0;
+}
+
+void
+lua_gobject_arena_open (lua_State *L, LuaGObjectState *state)
+{
+  Arena *arena;
+
+  /* Take the idle arena, if there is any, so that nested calls do not
+     share it. */
+  luaL_checkstack (L, 3, NULL);
+  lua_gobject_state_push (L, state, arena_idle);
+  arena = lua_touserdata (L, -1);
+  if (arena != NULL)
+    {
+      lua_pushboolean (L, 0);
+      lua_rawseti (L, LUA_REGISTRYINDEX, state->arena_idle);
+    }
+  else
+    {
+      lua_pop (L, 1);
+      arena = lua_newuserdata (L, sizeof (Arena));
+      arena->cleanups = NULL;
+      arena->chunks = NULL;
+      arena->pos = arena->block.data;
+      arena->end = arena->pos + ARENA_BLOCK_SIZE;
+      luaL_getmetatable (L, UD_ARENA);
+      lua_setmetatable (L, -2);
+    }
+
+  arena->state = state;
+  arena->outer = state->arena;
+  state->arena = arena;
+}
+
+void
+lua_gobject_arena_close (lua_State *L, LuaGObjectState *state, int index)
+{
+  Arena *arena = lua_touserdata (L, index);
+
+  /* Arenas of nested calls which raised an error are still current,
+     release them together with ours. */
+  while (state->arena != arena)
+    {
+      Arena *abandoned = state->arena;
+      g_assert (abandoned != NULL);
+      arena_release (abandoned);
+      state->arena = abandoned->outer;
+      abandoned->outer = NULL;
+    }
+
+  arena_release (arena);
+  state->arena = arena->outer;
+  arena->outer = NULL;
+
+  /* Keep the arena for the next call, unless some nested call already
+     returned its own one. */
+  luaL_checkstack (L, 2, NULL);
+  lua_gobject_state_push (L, state, arena_idle);
+  if (lua_touserdata (L, -1) == NULL)
+    {
+      lua_pushvalue (L, index);
+      lua_rawseti (L, LUA_REGISTRYINDEX, state->arena_idle);
+    }
+  lua_pop (L, 1);
+}
+
+gpointer *
+lua_gobject_arena_guard (lua_State *L, gboolean in_call,
+			 GDestroyNotify destroy, int *pushed)
+{
+  Arena *arena = in_call ? lua_gobject_state_get (L)->arena : NULL;
+  if (arena != NULL)
+    {
+      ArenaCleanup *cleanup = arena_alloc (arena, sizeof (ArenaCleanup));
+      g_assert (destroy != NULL);
+      cleanup->next = arena->cleanups;
+      cleanup->data = NULL;
+      cleanup->destroy = destroy;
+      arena->cleanups = cleanup;
+      return &cleanup->data;
+    }
+
+  (*pushed)++;
+  return lua_gobject_guard_create (L, destroy);
+}
+
+gpointer
+lua_gobject_arena_alloc (lua_State *L, gboolean in_call, gsize size)
+{
+  Arena *arena = in_call ? lua_gobject_state_get (L)->arena : NULL;
+  return arena != NULL ? memset (arena_alloc (arena, size), 0, size) : NULL;
+}
+
 void
 lua_gobject_state_enter (gpointer state_lock)
 {
@@ -399,8 +627,9 @@ core_yield (lua_State *L)
 {
   /* Perform yield with unlocked mutex; this might force another
      threads waiting on the mutex to perform what they need to do
-     (i.e. enter Lua with callbacks). */
-  gpointer state_lock = lua_gobject_state_get_lock (L);
+     (i.e. enter Lua with callbacks).  The state lock is passed as an
+     upvalue, yield is called often from busy loops. */
+  gpointer state_lock = lua_touserdata (L, lua_upvalueindex (1));
   lua_gobject_state_leave (state_lock);
   g_thread_yield ();
   lua_gobject_state_enter (state_lock);
@@ -607,7 +836,6 @@ static const struct luaL_Reg lua_gobject_reg[] = {
   { "gtype", core_gtype },
   { "repotype", core_repotype },
   { "constant", core_constant },
-  { "yield", core_yield },
   { "registerlock", core_registerlock },
   { "band", core_band },
   { "bor", core_bor },
@@ -731,6 +959,12 @@ luaopen_LuaGObject_lua_gobject_core (lua_State* L)
   lua_setfield (L, -2, "__gc");
   lua_pop (L, 1);
 
+  /* Register 'arena' metatable. */
+  luaL_newmetatable (L, UD_ARENA);
+  lua_pushcfunction (L, arena_gc);
+  lua_setfield (L, -2, "__gc");
+  lua_pop (L, 1);
+
   /* Register 'module' metatable. */
   luaL_newmetatable (L, UD_MODULE);
   luaL_register (L, NULL, module_reg);
@@ -749,12 +983,27 @@ luaopen_LuaGObject_lua_gobject_core (lua_State* L)
   lua_pushlightuserdata (L, &call_mutex);
   mutex = lua_newuserdata (L, sizeof (*mutex));
   mutex->mutex = &mutex->state_mutex;
+  mutex->state.lock = mutex;
+  mutex->state.callable_mt = LUA_NOREF;
+  mutex->state.record_mt = LUA_NOREF;
+  mutex->state.record_cache = LUA_NOREF;
+  mutex->state.parent_cache = LUA_NOREF;
+  mutex->state.object_mt = LUA_NOREF;
+  mutex->state.object_cache = LUA_NOREF;
+  mutex->state.object_access_cache = LUA_NOREF;
   g_rec_mutex_init (&mutex->state_mutex);
   g_rec_mutex_lock (&mutex->state_mutex);
   lua_pushlightuserdata (L, &call_mutex_mt);
   lua_rawget (L, LUA_REGISTRYINDEX);
   lua_setmetatable (L, -2);
   lua_rawset (L, LUA_REGISTRYINDEX);
+  lua_pushboolean (L, 0);
+  mutex->state.arena = NULL;
+  mutex->state.closure_store = NULL;
+  mutex->state.closure_refs = LUA_NOREF;
+  mutex->state.closure_interned = LUA_NOREF;
+  mutex->state.callback_threads = LUA_NOREF;
+  mutex->state.arena_idle = luaL_ref (L, LUA_REGISTRYINDEX);
 
   /* Register 'lua_gobject.core' interface. */
   lua_newtable (L);
@@ -769,8 +1018,11 @@ luaopen_LuaGObject_lua_gobject_core (lua_State* L)
   lua_setfield (L, -2, "id");
 
   /* Add lock and enter/leave locking functions. */
-  lua_pushlightuserdata (L, lua_gobject_state_get_lock (L));
+  lua_pushlightuserdata (L, mutex);
   lua_setfield (L, -2, "lock");
+  lua_pushlightuserdata (L, mutex);
+  lua_pushcclosure (L, core_yield, 1);
+  lua_setfield (L, -2, "yield");
   lua_pushlightuserdata (L, lua_gobject_state_enter);
   lua_setfield (L, -2, "enter");
   lua_pushlightuserdata (L, lua_gobject_state_leave);
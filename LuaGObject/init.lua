@@ -22,7 +22,7 @@ local core = require 'LuaGObject.core'
 local LuaGObject = { _NAME = 'LuaGObject', _VERSION = require 'LuaGObject.version' }
 
 -- Forward selected core methods into external interface.
-for _, name in pairs { 'yield', 'lock', 'enter', 'leave' } do
+for _, name in pairs { 'yield', 'lock', 'enter', 'leave', 'container' } do
    LuaGObject[name] = core[name]
 end
 
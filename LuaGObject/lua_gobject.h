@@ -72,10 +72,10 @@ GType lua_gobject_type_get_gtype (lua_State *L, int narg);
    handler. Returns pointer to user_data stored inside guard. */
 gpointer *lua_gobject_guard_create (lua_State *L, GDestroyNotify destroy);
 
-/* Creates cache table (optionally with given table __mode), stores it
-   into registry to specified userdata address. */
+/* Creates cache table (optionally with given table __mode) and
+   pushes it to the stack. */
 void
-lua_gobject_cache_create (lua_State *L, gpointer key, const char *mode);
+lua_gobject_cache_create (lua_State *L, const char *mode);
 
 /* Initialization of modules. */
 void lua_gobject_marshal_init (lua_State *L);
@@ -94,6 +94,49 @@ lua_gobject_udata_test (lua_State *L, int narg, const char *name);
    http://permalink.gmane.org/gmane.comp.lang.lua.general/79288 */
 #define LUA_GOBJECT_BYTES_BUFFER "bytes.bytearray"
 
+/* Metatable name of buffer view, which behaves like bytes buffer but
+   refers to external memory. */
+#define LUA_GOBJECT_BYTES_VIEW "lua_gobject.bytes.view"
+
+/* Creates buffer view of size bytes of memory at data and pushes it
+   to the stack.  The memory has to stay valid until the view is
+   collected, at which point destroy is called for owner (if
+   destroy is not NULL). */
+void lua_gobject_buffer_view_new (lua_State *L, gpointer data, gsize size,
+				  gboolean writable, GDestroyNotify destroy,
+				  gpointer owner);
+
+/* Checks whether narg is bytes buffer or buffer view.  If yes,
+   returns address of its data and stores its size (if size is not
+   NULL), otherwise returns NULL. */
+gpointer lua_gobject_buffer_test (lua_State *L, int narg, gsize *size);
+
+/* Like lua_gobject_buffer_test(), but raises an error when narg is
+   read-only buffer view, for memory which C code is going to write
+   into. */
+gpointer lua_gobject_buffer_test_writable (lua_State *L, int narg,
+					   gsize *size);
+
+/* Metatable name of typed array, a view of C array of numeric
+   elements. */
+#define LUA_GOBJECT_ARRAY "lua_gobject.array"
+
+/* Returns size of typed array element of given type tag, 0 if the
+   type is not supported by typed arrays. */
+gsize lua_gobject_array_elt_size (GITypeTag tag);
+
+/* Creates typed array with length elements of given type and pushes
+   it to the stack.  When owned is set, takes ownership of data (to be
+   released by g_free()), otherwise copies data (or zero-fills the
+   array when data is NULL).  Returns address of array data. */
+gpointer lua_gobject_array_new (lua_State *L, GITypeTag tag, gpointer data,
+				gsize length, gboolean owned);
+
+/* Checks whether narg is typed array of given element type.  If yes,
+   stores its data address and length and returns TRUE. */
+gboolean lua_gobject_array_test (lua_State *L, int narg, GITypeTag tag,
+				 gpointer *data, gsize *length);
+
 /* Metatable name of userdata - gi wrapped 'GIBaseInfo*' */
 #define LUA_GOBJECT_GI_INFO "lua_gobject.gi.info"
 
@@ -109,6 +152,87 @@ gpointer lua_gobject_gi_load_function(lua_State *L, int typetable, const char *n
    leaving the state using lua_gobject_state_enter() and lua_gobject_state_leave(). */
 gpointer lua_gobject_state_get_lock (lua_State *L);
 
+/* Per-state block, caching values needed on hot paths so that they
+   can be reached without hashing lightuserdata keys in
+   LUA_REGISTRYINDEX.  It lives as long as the state itself.  Hot
+   functions receive it as their first upvalue, see
+   lua_gobject_state_register(). */
+typedef struct _LuaGObjectState
+{
+  /* State lock, the same as returned by lua_gobject_state_get_lock(). */
+  gpointer lock;
+
+  /* LUA_REGISTRYINDEX references of metatables and caches. */
+  int callable_mt;
+  int record_mt;
+  int record_cache;
+  int parent_cache;
+  int object_mt;
+  int object_cache;
+  int object_access_cache;
+
+  /* Arena of the call being marshalled, NULL outside of it, and
+     reference to idle arena kept for reuse (false when none). */
+  gpointer arena;
+  int arena_idle;
+
+  /* Store of closure data (free slots and pooled closure blocks)
+     and reference to the table with Lua values used by closures. */
+  gpointer closure_store;
+  int closure_refs;
+
+  /* Reference to the table mapping Lua targets to interned closure
+     blocks. */
+  int closure_interned;
+
+  /* Reference to the table with pool of callback threads. */
+  int callback_threads;
+} LuaGObjectState;
+
+/* Retrieves per-state block of given state. */
+LuaGObjectState *lua_gobject_state_get (lua_State *L);
+
+/* Registers functions into the table on the top of the stack, each
+   with the per-state block as its first upvalue. */
+void lua_gobject_state_register (lua_State *L, LuaGObjectState *state,
+				 const luaL_Reg *reg);
+
+/* Pushes registry value referenced by given member of per-state
+   block. */
+#define lua_gobject_state_push(L, state, member)	\
+  lua_rawgeti (L, LUA_REGISTRYINDEX, (state)->member)
+
+/* Per-call arena for temporary values needed only until the call
+   being marshalled returns.  callable_call() opens the arena before
+   marshalling arguments and closes it when the call finishes,
+   releasing all temporaries deterministically.  Arena abandoned by
+   an error raised during marshalling is released when the enclosing
+   call closes its own arena or when the arena is collected,
+   whichever comes first. */
+
+/* Pushes the arena to the stack and makes it current.  The arena
+   remembers previously current one. */
+void lua_gobject_arena_open (lua_State *L, LuaGObjectState *state);
+
+/* Releases all temporaries of the current arena, which is at given
+   stack index, and makes the arena which was current when it was
+   opened current again. */
+void lua_gobject_arena_close (lua_State *L, LuaGObjectState *state,
+			      int index);
+
+/* Registers destroy handler for temporary value of the current call,
+   returns address of slot which should be filled with the value.
+   When in_call is FALSE or no arena is current, creates guard on the
+   stack instead (see lua_gobject_guard_create()) and increments
+   *pushed. */
+gpointer *lua_gobject_arena_guard (lua_State *L, gboolean in_call,
+				   GDestroyNotify destroy, int *pushed);
+
+/* Allocates zero-filled temporary memory from the arena of the
+   current call.  Returns NULL when in_call is FALSE or no arena is
+   current. */
+gpointer lua_gobject_arena_alloc (lua_State *L, gboolean in_call, gsize size);
+
 /* Enters/leaves Lua state. */
 void lua_gobject_state_enter (gpointer left_state);
 void lua_gobject_state_leave (gpointer state_lock);
@@ -131,10 +255,13 @@ void lua_gobject_state_leave (gpointer state_lock);
 
 /* Marshalls single value from Lua to GLib/C. Returns number of temporary
    entries pushed to Lua stack, which should be popped before function call
-   returns. */
+   returns.  in_call is set when marshalling arguments of a call which
+   opened its own arena; temporaries are then registered in the arena
+   instead of being pushed to the stack. */
 int lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 		    GITransfer xfer,  gpointer target, int narg,
-		    int parent, GICallableInfo *ci, void **args);
+		    int parent, GICallableInfo *ci, void **args,
+		    gboolean in_call);
 
 /* If given parameter is out:caller-allocates, tries to perform
    special 2c marshalling.  If not needed, returns FALSE, otherwise
@@ -150,6 +277,38 @@ void lua_gobject_marshal_2lua (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 		       gpointer source, int parent,
 		       GICallableInfo *ci, void *args);
 
+/* Marshals C array or GArray of numeric elements into typed array
+   view instead of Lua table.  Returns FALSE (and pushes nothing) when
+   the array cannot be represented by typed array. */
+gboolean lua_gobject_marshal_2lua_array_view (lua_State *L, GITypeInfo *ti,
+					      GITransfer transfer,
+					      gpointer source,
+					      GICallableInfo *ci, void *args);
+
+/* Marshals GList, GSList or GHashTable into lazy proxy, which owns
+   the container and marshals its elements only when they are
+   accessed.  Returns FALSE (and pushes nothing) when the container
+   cannot be represented by lazy proxy. */
+gboolean lua_gobject_marshal_2lua_lazy (lua_State *L, GITypeInfo *ti,
+					GIDirection dir, GITransfer xfer,
+					gpointer data);
+
+/* Marshals integral (or GType) value of given type tag to C or to
+   Lua. */
+void lua_gobject_marshal_2c_int (lua_State *L, GITypeTag tag, GIArgument *val,
+			 int narg, gboolean optional, int parent);
+void lua_gobject_marshal_2lua_int (lua_State *L, GITypeTag tag, GIArgument *val,
+			   int parent);
+
+/* Marshals GValue from/to Lua.  Values of basic fundamental types
+   (given as fundamental, or G_TYPE_INVALID to query it from the
+   value) are marshalled natively, the rest goes through
+   GObject.Value. */
+void lua_gobject_marshal_value_2c (lua_State *L, int narg, GValue *value,
+				   GType fundamental);
+void lua_gobject_marshal_value_2lua (lua_State *L, const GValue *value,
+				     GType fundamental);
+
 /* Marshalls field to/from given memory (struct, union or
    object). Returns number of results pushed to the stack (0 or 1). */
 int lua_gobject_marshal_field (lua_State *L, gpointer object, gboolean getmode,
@@ -180,6 +339,34 @@ gpointer lua_gobject_closure_create (lua_State* L, gpointer user_data,
 /* GDestroyNotify-compatible callback for destroying closure. */
 void lua_gobject_closure_destroy (gpointer user_data);
 
+/* Pops value from the stack and stores it into newly allocated slot
+   of the closure store of the state, which is returned.  Stored
+   value is retrieved by lua_rawgeti() from the table referenced by
+   state->closure_refs. */
+int lua_gobject_closure_ref (lua_State *L, LuaGObjectState *state);
+
+/* Releases slot allocated by lua_gobject_closure_ref(). */
+void lua_gobject_closure_unref (lua_State *L, LuaGObjectState *state,
+				int slot);
+
+/* Takes an idle thread from the pool of callback threads, used when
+   callback arrives while its own thread is suspended.  The thread
+   must be returned by lua_gobject_callback_thread_release(). */
+lua_State *lua_gobject_callback_thread_acquire (lua_State *L,
+						LuaGObjectState *state);
+void lua_gobject_callback_thread_release (LuaGObjectState *state,
+					  lua_State *L);
+
+/* GDestroyNotify-compatible callback for releasing closure of
+   scope=call argument after the call.  The block might be pooled and
+   returned by following lua_gobject_closure_allocate(). */
+void lua_gobject_closure_release (gpointer user_data);
+
+/* Pushes Callable for given callback info.  Callables of top-level
+   callback types are cached, so that pooled closures prepared for
+   them can be reused. */
+int lua_gobject_callable_create_callback (lua_State *L, GICallableInfo *ci);
+
 /* Allocates and creates new record instance. Assumes that repotype table
    is on the stack, replaces it with newly created proxy. */
 gpointer lua_gobject_record_new (lua_State *L, int count, gboolean alloc);
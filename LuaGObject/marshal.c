@@ -57,9 +57,9 @@ typedef union {
 /* Marshals integral types to C.  If requested, makes sure that the
    value is actually marshalled into val->v_pointer no matter what the
    input type is. */
-static void
-marshal_2c_int (lua_State *L, GITypeTag tag, GIArgument *val, int narg,
-		gboolean optional, int parent)
+void
+lua_gobject_marshal_2c_int (lua_State *L, GITypeTag tag, GIArgument *val,
+			    int narg, gboolean optional, int parent)
 {
   (void) optional;
   switch (tag)
@@ -125,9 +125,9 @@ marshal_2c_int (lua_State *L, GITypeTag tag, GIArgument *val, int narg,
 }
 
 /* Marshals integral types from C to Lua. */
-static void
-marshal_2lua_int (lua_State *L, GITypeTag tag, GIArgument *val,
-		  int parent)
+void
+lua_gobject_marshal_2lua_int (lua_State *L, GITypeTag tag, GIArgument *val,
+			      int parent)
 {
   switch (tag)
     {
@@ -312,21 +312,82 @@ byte_array_detach (GByteArray *array)
   g_byte_array_free (array, FALSE);
 }
 
+/* Native containers are implemented below, next to the marshalling of
+   containers to Lua. */
+static gboolean lazy_2c (lua_State *L, int narg, GITypeInfo *ti,
+			 GITypeTag tag, GITransfer transfer, gpointer *data);
+static gboolean lazy_push_table (lua_State *L, int narg);
+
+/* Converts numbers from the array part of the table at narg directly
+   into C array of numeric elements of given type, without going
+   through generic marshalling of every element.  Returns FALSE if the
+   element type has no dedicated conversion. */
+static gboolean
+marshal_2c_array_numbers (lua_State *L, int narg, GITypeTag tag,
+			  gpointer data, gint len)
+{
+  gint index;
+
+  switch (tag)
+    {
+#define HANDLE_ELT(nameup, ctype, conv)				\
+      case GI_TYPE_TAG_ ## nameup:				\
+	for (index = 0; index < len; index++)			\
+	  {							\
+	    lua_rawgeti (L, narg, index + 1);			\
+	    ((ctype *) data)[index] = (ctype) conv;		\
+	    lua_pop (L, 1);					\
+	  }							\
+	return TRUE
+
+      HANDLE_ELT(INT8, gint8, check_integer (L, -1, G_MININT8, G_MAXINT8));
+      HANDLE_ELT(UINT8, guint8, check_integer (L, -1, 0, G_MAXUINT8));
+      HANDLE_ELT(INT16, gint16, check_integer (L, -1, G_MININT16, G_MAXINT16));
+      HANDLE_ELT(UINT16, guint16, check_integer (L, -1, 0, G_MAXUINT16));
+      HANDLE_ELT(INT32, gint32, check_integer (L, -1, G_MININT32, G_MAXINT32));
+      HANDLE_ELT(UINT32, guint32, check_integer (L, -1, 0, G_MAXUINT32));
+#if LUA_VERSION_NUM >= 503
+      HANDLE_ELT(INT64, gint64,
+		 check_integer (L, -1, LUA_MININTEGER, LUA_MAXINTEGER));
+      HANDLE_ELT(UINT64, guint64, check_integer (L, -1, 0, LUA_MAXINTEGER));
+#else
+      HANDLE_ELT(INT64, gint64,
+		 check_integer (L, -1, ((lua_Number) -0x7f00000000000000LL) - 1,
+				0x7fffffffffffffffLL));
+      HANDLE_ELT(UINT64, guint64,
+		 check_integer (L, -1, 0, 0xffffffffffffffffULL));
+#endif
+      HANDLE_ELT(FLOAT, gfloat, luaL_checknumber (L, -1));
+      HANDLE_ELT(DOUBLE, gdouble, luaL_checknumber (L, -1));
+#undef HANDLE_ELT
+
+    default:
+      return FALSE;
+    }
+}
+
 /* Marshalls array from Lua to C. Returns number of temporary elements
-   pushed to the stack. */
+   pushed to the stack.  When in_call is set, temporaries are kept in
+   the arena of the current call instead.  Byte buffers are accepted
+   only when they are writable if writable is set. */
 static int
 marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
 		  gpointer *out_array, gssize *out_size, int narg,
-		  gboolean optional, GITransfer transfer)
+		  gboolean optional, gboolean writable, GITransfer transfer,
+		  gboolean in_call)
 {
   GITypeInfo* eti;
   gssize objlen, esize;
-  gint index, vals = 0, to_pop, eti_guard;
+  gint index, vals = 0, to_pop, eti_guard = 0;
   GITransfer exfer = (transfer == GI_TRANSFER_EVERYTHING
 		      ? GI_TRANSFER_EVERYTHING : GI_TRANSFER_NOTHING);
   gboolean zero_terminated;
   GArray *array = NULL;
+  gchar *data = NULL;
   int parent = 0;
+  GITypeTag etag = GI_TYPE_TAG_VOID;
+  gpointer source = NULL;
+  gsize source_len = 0;
 
   /* Represent nil as NULL array. */
   if (optional && lua_isnoneornil (L, narg))
@@ -338,10 +399,31 @@ marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
     {
       /* Get element type info, create guard for it. */
       eti = gi_type_info_get_param_type (ti, 0);
-      lua_gobject_gi_info_new (L, GI_BASE_INFO (eti));
-      eti_guard = lua_gettop (L);
+      *lua_gobject_arena_guard (L, in_call,
+				(GDestroyNotify) gi_base_info_unref,
+				&eti_guard) = eti;
+      if (eti_guard)
+	eti_guard = lua_gettop (L);
       esize = array_get_elt_size (eti, atype == GI_ARRAY_TYPE_PTR_ARRAY);
 
+      /* Native pointer array of the same type is passed as-is,
+	 otherwise its contents are marshalled as a table. */
+      if (atype == GI_ARRAY_TYPE_PTR_ARRAY)
+	{
+	  if (lazy_2c (L, narg, ti, GI_TYPE_TAG_ARRAY, transfer, out_array))
+	    {
+	      *out_size = ((GPtrArray *) *out_array)->len;
+	      if (eti_guard)
+		lua_remove (L, eti_guard);
+	      return vals;
+	    }
+	  else if (lazy_push_table (L, narg))
+	    {
+	      narg = lua_gettop (L);
+	      vals++;
+	    }
+	}
+
       /* Check the type. If this is C-array of byte-sized elements, we
 	 can try special-case and accept strings or buffers. */
       *out_array = NULL;
@@ -349,9 +431,12 @@ marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
 	  && atype == GI_ARRAY_TYPE_C)
 	{
 	  size_t size = 0;
-	  *out_array = lua_gobject_udata_test (L, narg, LUA_GOBJECT_BYTES_BUFFER);
+	  gsize buffer_size;
+	  *out_array = writable
+	    ? lua_gobject_buffer_test_writable (L, narg, &buffer_size)
+	    : lua_gobject_buffer_test (L, narg, &buffer_size);
 	  if (*out_array)
-	    size = lua_objlen (L, narg);
+	    size = buffer_size;
 	  else
 	    *out_array = (gpointer *) lua_tolstring (L, narg, &size);
 
@@ -361,59 +446,107 @@ marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
 	  *out_size = size;
 	}
 
+      /* Numeric elements can be converted by dedicated kernels and
+	 typed arrays of the same element type can be used as is. */
+      if (!gi_type_info_is_pointer (eti)
+	  && (atype == GI_ARRAY_TYPE_C || atype == GI_ARRAY_TYPE_ARRAY))
+	etag = gi_type_info_get_tag (eti);
+      if (!*out_array && etag != GI_TYPE_TAG_VOID
+	  && lua_type (L, narg) == LUA_TUSERDATA
+	  && !lua_gobject_array_test (L, narg, etag, &source, &source_len))
+	etag = GI_TYPE_TAG_VOID;
+
       if (!*out_array)
 	{
 	  /* Otherwise, we allow only tables. */
-	  luaL_checktype (L, narg, LUA_TTABLE);
+	  if (source == NULL)
+	    luaL_checktype (L, narg, LUA_TTABLE);
 
 	  /* Find out how long array should we allocate. */
 	  zero_terminated = gi_type_info_is_zero_terminated (ti);
-	  objlen = lua_objlen (L, narg);
+	  objlen = source ? (gssize) source_len : (gssize) lua_objlen (L, narg);
           if (atype != GI_ARRAY_TYPE_C || !gi_type_info_get_array_fixed_size (ti, (gsize *)out_size))
 	    *out_size = objlen;
 	  else if (*out_size < objlen)
 	    objlen = *out_size;
 
+	  /* Data of typed array which stays owned by us can be passed
+	     to C directly. */
+	  if (source != NULL && atype == GI_ARRAY_TYPE_C
+	      && transfer == GI_TRANSFER_NOTHING && !zero_terminated
+	      && *out_size == objlen)
+	    {
+	      *out_array = source;
+	      if (eti_guard)
+		lua_remove (L, eti_guard);
+	      return vals;
+	    }
+
 	  /* Allocate the array and wrap it into the userdata guard,
 	     if needed. */
 	  if (*out_size > 0 || zero_terminated)
 	    {
 	      guint total_size = *out_size + (zero_terminated ? 1 : 0);
-	      switch (atype)
-		{
-		case GI_ARRAY_TYPE_C:
-		case GI_ARRAY_TYPE_ARRAY:
-		  array = g_array_sized_new (zero_terminated, TRUE, esize,
-					     *out_size);
-		  g_array_set_size (array, *out_size);
-		  *lua_gobject_guard_create (L, (GDestroyNotify)
-				     (transfer == GI_TRANSFER_EVERYTHING
-				      ? array_detach : g_array_unref)) = array;
-		  break;
-
-		case GI_ARRAY_TYPE_PTR_ARRAY:
-		  parent = LUA_GOBJECT_PARENT_FORCE_POINTER;
-		  array = (GArray *) g_ptr_array_sized_new (total_size);
-		  g_ptr_array_set_size ((GPtrArray *) array, total_size);
-		  *lua_gobject_guard_create (L, (GDestroyNotify)
-				     (transfer == GI_TRANSFER_EVERYTHING
-				      ? ptr_array_detach :
-				      g_ptr_array_unref)) = array;
-		  break;
-
-		case GI_ARRAY_TYPE_BYTE_ARRAY:
-		  array = (GArray *) g_byte_array_sized_new (total_size);
-		  g_byte_array_set_size ((GByteArray *) array, *out_size);
-		  *lua_gobject_guard_create (L, (GDestroyNotify)
-				     (transfer == GI_TRANSFER_EVERYTHING
-				      ? byte_array_detach :
-				      g_byte_array_unref)) = array;
-		  break;
-		}
-	      vals = 1;
+
+	      /* C array which stays owned by us can be allocated
+		 directly in the arena, without any GArray wrapper. */
+	      if (atype == GI_ARRAY_TYPE_C && transfer == GI_TRANSFER_NOTHING)
+		data = lua_gobject_arena_alloc (L, in_call, total_size * esize);
+
+	      if (data == NULL)
+		switch (atype)
+		  {
+		  case GI_ARRAY_TYPE_C:
+		  case GI_ARRAY_TYPE_ARRAY:
+		    array = g_array_sized_new (zero_terminated, TRUE, esize,
+					       *out_size);
+		    g_array_set_size (array, *out_size);
+		    *lua_gobject_arena_guard (L, in_call, (GDestroyNotify)
+					      (transfer == GI_TRANSFER_EVERYTHING
+					       ? array_detach : g_array_unref),
+					      &vals) = array;
+		    break;
+
+		  case GI_ARRAY_TYPE_PTR_ARRAY:
+		    parent = LUA_GOBJECT_PARENT_FORCE_POINTER;
+		    array = (GArray *) g_ptr_array_sized_new (total_size);
+		    g_ptr_array_set_size ((GPtrArray *) array, total_size);
+		    *lua_gobject_arena_guard (L, in_call, (GDestroyNotify)
+					      (transfer == GI_TRANSFER_EVERYTHING
+					       ? ptr_array_detach :
+					       g_ptr_array_unref), &vals) = array;
+		    break;
+
+		  case GI_ARRAY_TYPE_BYTE_ARRAY:
+		    array = (GArray *) g_byte_array_sized_new (total_size);
+		    g_byte_array_set_size ((GByteArray *) array, *out_size);
+		    *lua_gobject_arena_guard (L, in_call, (GDestroyNotify)
+					      (transfer == GI_TRANSFER_EVERYTHING
+					       ? byte_array_detach :
+					       g_byte_array_unref), &vals) = array;
+		    break;
+		  }
+
+	      if (array != NULL)
+		data = array->data;
 	    }
 
-	  /* Iterate through Lua array and fill GArray accordingly. */
+	  /* Copy typed array in one go, convert numbers in a tight
+	     loop or iterate through Lua array and fill GArray
+	     accordingly. */
+	  if (source != NULL)
+	    {
+	      if (objlen > 0)
+		memcpy (data, source, objlen * esize);
+	      objlen = 0;
+	    }
+	  else if (etag != GI_TYPE_TAG_VOID && lua_getmetatable (L, narg))
+	    /* Tables with metatables go through generic path. */
+	    lua_pop (L, 1);
+	  else if (etag != GI_TYPE_TAG_VOID
+		   && marshal_2c_array_numbers (L, narg, etag, data, objlen))
+	    objlen = 0;
+
 	  for (index = 0; index < objlen; index++)
 	    {
 	      lua_pushinteger (L, index + 1);
@@ -422,8 +555,8 @@ marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
 	      /* Marshal element retrieved from the table into target
 		 array. */
 	      to_pop = lua_gobject_marshal_2c (L, eti, NULL, exfer,
-				       array->data + index * esize, -1,
-				       parent, NULL, NULL);
+				       data + index * esize, -1,
+				       parent, NULL, NULL, FALSE);
 
 	      /* Remove temporary element from the stack. */
 	      lua_remove (L, - to_pop - 1);
@@ -435,13 +568,13 @@ marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
 
 	  /* Return either GArray or direct pointer to the data,
 	     according to the array type. */
-	  if (array == NULL)
+	  if (data == NULL)
 	    *out_array = NULL;
 	  else
 	    switch (atype)
 	      {
 	      case GI_ARRAY_TYPE_C:
-		*out_array = (void *) array->data;
+		*out_array = (void *) data;
 		break;
 
 	      case GI_ARRAY_TYPE_ARRAY:
@@ -452,7 +585,8 @@ marshal_2c_array (lua_State *L, GITypeInfo *ti, GIArrayType atype,
 	      }
 	}
 
-      lua_remove (L, eti_guard);
+      if (eti_guard)
+	lua_remove (L, eti_guard);
     }
 
   return vals;
@@ -590,18 +724,96 @@ marshal_2lua_array (lua_State *L, GITypeInfo *ti, GIDirection dir,
   lua_remove (L, eti_guard);
 }
 
+gboolean
+lua_gobject_marshal_2lua_array_view (lua_State *L, GITypeInfo *ti,
+				     GITransfer transfer, gpointer source,
+				     GICallableInfo *ci, void *args)
+{
+  GIArrayType atype = gi_type_info_get_array_type (ti);
+  GITypeInfo *eti;
+  GITypeTag etag;
+  gboolean eptr;
+  gpointer array, data;
+  gssize size = -1;
+  gsize len = 0, esize;
+
+  if (atype != GI_ARRAY_TYPE_C && atype != GI_ARRAY_TYPE_ARRAY)
+    return FALSE;
+
+  /* Only arrays of plain numbers can be viewed; uint8 arrays keep
+     being marshalled as strings. */
+  eti = gi_type_info_get_param_type (ti, 0);
+  etag = gi_type_info_get_tag (eti);
+  eptr = gi_type_info_is_pointer (eti);
+  gi_base_info_unref (eti);
+  esize = lua_gobject_array_elt_size (etag);
+  if (eptr || esize == 0 || etag == GI_TYPE_TAG_UINT8)
+    return FALSE;
+
+  array = gi_type_info_is_pointer (ti) ? ((GIArgument *) source)->v_pointer
+    : source;
+  if (atype == GI_ARRAY_TYPE_ARRAY)
+    {
+      if (array == NULL)
+	return FALSE;
+      len = ((GArray *) array)->len;
+      data = ((GArray *) array)->data;
+    }
+  else
+    {
+      data = array;
+      if (gi_type_info_is_zero_terminated (ti))
+	{
+	  static const guint64 zero = 0;
+	  if (data != NULL)
+	    while (memcmp ((gchar *) data + len * esize, &zero, esize) != 0)
+	      len++;
+	}
+      else if (!gi_type_info_get_array_fixed_size (ti, &len))
+	{
+	  array_get_or_set_length (ti, &size, 0, GI_BASE_INFO (ci), args);
+	  len = size < 0 ? 1 : size;
+	}
+      if (data == NULL)
+	len = 0;
+    }
+
+  if (transfer == GI_TRANSFER_NOTHING || !gi_type_info_is_pointer (ti))
+    /* Copy borrowed data once. */
+    lua_gobject_array_new (L, etag, data, len, FALSE);
+  else if (atype == GI_ARRAY_TYPE_ARRAY)
+    /* Steal the data of the owned GArray. */
+    lua_gobject_array_new (L, etag, g_array_free (array, FALSE), len, TRUE);
+  else
+    /* Take ownership of the owned C array. */
+    lua_gobject_array_new (L, etag, data, len, TRUE);
+  return TRUE;
+}
+
 /* Marshalls GSList or GList from Lua to C. Returns number of
-   temporary elements pushed to the stack. */
+   temporary elements pushed to the stack.  When in_call is set,
+   temporaries are kept in the arena of the current call instead. */
 static int
 marshal_2c_list (lua_State *L, GITypeInfo *ti, GITypeTag list_tag,
-		 gpointer *list, int narg, GITransfer transfer)
+		 gpointer *list, int narg, GITransfer transfer,
+		 gboolean in_call)
 {
   GITypeInfo *eti;
   GITransfer exfer = (transfer == GI_TRANSFER_EVERYTHING
 		      ? GI_TRANSFER_EVERYTHING : GI_TRANSFER_NOTHING);
-  gint index, vals = 0, to_pop, eti_guard;
+  gint index, vals = 0, to_pop, eti_guard = 0;
   GSList **guard = NULL;
 
+  /* Native list of the same type is passed as-is, otherwise its
+     contents are marshalled as a table. */
+  if (lazy_2c (L, narg, ti, list_tag, transfer, list))
+    return 0;
+  else if (lazy_push_table (L, narg))
+    {
+      narg = lua_gettop (L);
+      vals = 1;
+    }
+
   /* Allow empty list to be expressed also as 'nil', because in C,
      there is no difference between NULL and empty list. */
   if (lua_isnoneornil (L, narg))
@@ -615,14 +827,18 @@ marshal_2c_list (lua_State *L, GITypeInfo *ti, GITypeTag list_tag,
   /* Get list element type info, create guard for it so that we don't
      leak it. */
   eti = gi_type_info_get_param_type (ti, 0);
-  lua_gobject_gi_info_new (L, GI_BASE_INFO (eti));
-  eti_guard = lua_gettop (L);
+  *lua_gobject_arena_guard (L, in_call, (GDestroyNotify) gi_base_info_unref,
+			    &eti_guard) = eti;
+  if (eti_guard)
+    eti_guard = lua_gettop (L);
 
   /* Go from back and prepend to the list, which is cheaper than
      appending. */
-  guard = (GSList **) lua_gobject_guard_create (L, list_tag == GI_TYPE_TAG_GSLIST
-					? (GDestroyNotify) g_slist_free
-					: (GDestroyNotify) g_list_free);
+  guard = (GSList **) lua_gobject_arena_guard (L, in_call,
+					       list_tag == GI_TYPE_TAG_GSLIST
+					       ? (GDestroyNotify) g_slist_free
+					       : (GDestroyNotify) g_list_free,
+					       &vals);
   while (index > 0)
     {
       /* Retrieve index-th element from the source table and marshall
@@ -631,7 +847,7 @@ marshal_2c_list (lua_State *L, GITypeInfo *ti, GITypeTag list_tag,
       lua_pushinteger (L, index--);
       lua_gettable (L, narg);
       to_pop = lua_gobject_marshal_2c (L, eti, NULL, exfer, &eval, -1,
-			       LUA_GOBJECT_PARENT_FORCE_POINTER, NULL, NULL);
+			       LUA_GOBJECT_PARENT_FORCE_POINTER, NULL, NULL, FALSE);
 
       /* Prepend new list element and reassign the guard. */
       if (list_tag == GI_TYPE_TAG_GSLIST)
@@ -645,7 +861,8 @@ marshal_2c_list (lua_State *L, GITypeInfo *ti, GITypeTag list_tag,
 
   /* Marshalled value is kept inside the guard. */
   *list = *guard;
-  lua_remove (L, eti_guard);
+  if (eti_guard)
+    lua_remove (L, eti_guard);
   return vals;
 }
 
@@ -695,12 +912,12 @@ marshal_2lua_list (lua_State *L, GITypeInfo *ti, GIDirection dir,
    elements pushed to the stack. */
 static int
 marshal_2c_hash (lua_State *L, GITypeInfo *ti, GHashTable **table, int narg,
-		 gboolean optional, GITransfer transfer)
+		 gboolean optional, GITransfer transfer, gboolean in_call)
 {
   GITypeInfo *eti[2];
   GITransfer exfer = (transfer == GI_TRANSFER_EVERYTHING
 		      ? GI_TRANSFER_EVERYTHING : GI_TRANSFER_NOTHING);
-  gint i, vals = 0, guard;
+  gint i, vals = 0, guard, eti_guards = 0;
   GHashTable **guarded_table;
   GHashFunc hash_func;
   GEqualFunc equal_func;
@@ -708,8 +925,17 @@ marshal_2c_hash (lua_State *L, GITypeInfo *ti, GHashTable **table, int narg,
   /* Represent nil as NULL table. */
   if (optional && lua_isnoneornil (L, narg))
     *table = NULL;
-  else
+  else if (!lazy_2c (L, narg, ti, GI_TYPE_TAG_GHASH, transfer,
+		     (gpointer *) table))
     {
+      /* Native hash table of different type is marshalled as a
+	 table. */
+      if (lazy_push_table (L, narg))
+	{
+	  narg = lua_gettop (L);
+	  vals = 1;
+	}
+
       /* Check the type; we allow tables only. */
       luaL_checktype (L, narg, LUA_TTABLE);
 
@@ -718,14 +944,16 @@ marshal_2c_hash (lua_State *L, GITypeInfo *ti, GHashTable **table, int narg,
       for (i = 0; i < 2; i++)
 	{
 	  eti[i] = gi_type_info_get_param_type (ti, i);
-	  lua_gobject_gi_info_new (L, GI_BASE_INFO (eti[i]));
+	  *lua_gobject_arena_guard (L, in_call,
+				    (GDestroyNotify) gi_base_info_unref,
+				    &eti_guards) = eti[i];
 	}
 
       /* Create the hashtable and guard it so that it is destroyed in
 	 case something goes wrong during marshalling. */
       guarded_table = (GHashTable **)
-	lua_gobject_guard_create (L, (GDestroyNotify) g_hash_table_destroy);
-      vals++;
+	lua_gobject_arena_guard (L, in_call,
+				 (GDestroyNotify) g_hash_table_destroy, &vals);
 
       /* Find out which hash_func and equal_func should be used,
 	 according to the type of the key. */
@@ -763,7 +991,7 @@ marshal_2c_hash (lua_State *L, GITypeInfo *ti, GHashTable **table, int narg,
 	  for (i = 0; i < 2; i++)
 	    vals += lua_gobject_marshal_2c (L, eti[i], NULL, exfer, &eval[i],
 				    key_pos + i, LUA_GOBJECT_PARENT_FORCE_POINTER,
-				    NULL, NULL);
+				    NULL, NULL, FALSE);
 
 	  /* Insert newly marshalled pointers into the table. */
 	  g_hash_table_insert (*table, eval[0].v_pointer, eval[1].v_pointer);
@@ -778,8 +1006,8 @@ marshal_2c_hash (lua_State *L, GITypeInfo *ti, GHashTable **table, int narg,
 	}
 
       /* Remove guards for element types. */
-      lua_remove (L, guard);
-      lua_remove (L, guard);
+      while (eti_guards-- > 0)
+	lua_remove (L, guard);
     }
 
   return vals;
@@ -834,6 +1062,810 @@ marshal_2lua_hash (lua_State *L, GITypeInfo *ti, GIDirection dir,
     }
 }
 
+/* Native container (GList, GSList, GPtrArray or GHashTable) owned by
+   Lua.  Containers returned from C are lazy proxies, which marshal
+   elements only when they are accessed; containers created by
+   core.container builders are filled from Lua and own their
+   elements.  Both can be passed back to C without re-marshalling.
+   Elements of lists and pointer arrays are cached in the environment
+   table of the proxy, so that every element is marshalled (and its
+   ownership taken) only once. */
+typedef struct _LazyContainer
+{
+  /* List head, GPtrArray or GHashTable. */
+  gpointer data;
+
+  /* Last node of the list filled by builder. */
+  GSList *last;
+
+  /* Element type infos, key and value ones for hash tables. */
+  GITypeInfo *eti[2];
+
+  /* Function freeing elements of builder list. */
+  GDestroyNotify free_elt;
+
+  /* Container type tag (GI_TYPE_TAG_ARRAY for GPtrArray), direction
+     and transfer of the elements. */
+  guint tag : 5;
+  guint dir : 2;
+  guint xfer : 2;
+
+  /* Set for containers created by builders, which can be modified. */
+  guint builder : 1;
+
+  /* Set when some elements were taken over by Lua, so that the
+     container does not own all of them any more. */
+  guint taken : 1;
+
+  /* Set when the container was given away to C. */
+  guint given_away : 1;
+
+  /* List node at (0-based) cursor_index, speeding up sequential
+     access. */
+  GSList *cursor;
+  gint cursor_index;
+
+  /* Length of the list, -1 when not known yet. */
+  gint length;
+} LazyContainer;
+
+#define UD_LAZY_CONTAINER "lua_gobject.container"
+
+/* State of pairs() iteration of lazy hash table. */
+typedef struct _LazyIter
+{
+  GHashTableIter iter;
+} LazyIter;
+
+static gint
+lazy_length (LazyContainer *container)
+{
+  if (container->data == NULL)
+    return 0;
+  else if (container->tag == GI_TYPE_TAG_GHASH)
+    return g_hash_table_size (container->data);
+  else if (container->tag == GI_TYPE_TAG_ARRAY)
+    return ((GPtrArray *) container->data)->len;
+
+  if (container->length < 0)
+    container->length = g_slist_length (container->data);
+  return container->length;
+}
+
+/* Returns address of (0-based) index-th element of list or pointer
+   array. */
+static gpointer *
+lazy_element (LazyContainer *container, gint index)
+{
+  if (container->tag == GI_TYPE_TAG_ARRAY)
+    return &g_ptr_array_index ((GPtrArray *) container->data, index);
+
+  /* Find the node, continuing from the cursor if possible. */
+  if (container->cursor == NULL || container->cursor_index > index)
+    {
+      container->cursor = container->data;
+      container->cursor_index = 0;
+    }
+  for (; container->cursor_index < index; container->cursor_index++)
+    container->cursor = g_slist_next (container->cursor);
+  return &container->cursor->data;
+}
+
+/* Pushes (0-based) index-th element of lazy list or pointer array at
+   narg, marshalling it if it was not accessed yet. */
+static void
+lazy_list_push (lua_State *L, int narg, LazyContainer *container, gint index)
+{
+  lua_getfenv (L, narg);
+  lua_rawgeti (L, -1, index + 1);
+  if (lua_isnil (L, -1))
+    {
+      lua_pop (L, 1);
+      if (container->xfer == GI_TRANSFER_EVERYTHING)
+	container->taken = TRUE;
+      lua_gobject_marshal_2lua (L, container->eti[0], NULL, container->dir,
+				container->xfer,
+				lazy_element (container, index),
+				LUA_GOBJECT_PARENT_FORCE_POINTER, NULL, NULL);
+      lua_pushvalue (L, -1);
+      lua_rawseti (L, -3, index + 1);
+    }
+  lua_remove (L, -2);
+}
+
+/* Pushes key and value of hash table entry. */
+static void
+lazy_hash_push (lua_State *L, LazyContainer *container,
+		gpointer key, gpointer value)
+{
+  GIArgument eval[2];
+  gint i;
+  eval[0].v_pointer = key;
+  eval[1].v_pointer = value;
+  for (i = 0; i < 2; i++)
+    lua_gobject_marshal_2lua (L, container->eti[i], NULL, container->dir,
+			      GI_TRANSFER_NOTHING, &eval[i],
+			      LUA_GOBJECT_PARENT_FORCE_POINTER, NULL, NULL);
+}
+
+/* Marshals Lua value at narg into element of builder container, which
+   then owns it. */
+static gpointer
+lazy_element_2c (lua_State *L, GITypeInfo *eti, int narg)
+{
+  GIArgument eval;
+  int vals = lua_gobject_marshal_2c (L, eti, NULL, GI_TRANSFER_EVERYTHING,
+				     &eval, narg,
+				     LUA_GOBJECT_PARENT_FORCE_POINTER,
+				     NULL, NULL, FALSE);
+  lua_pop (L, vals);
+  return eval.v_pointer;
+}
+
+/* Iterator of lazy list, returning index and element. */
+static int
+lazy_list_next (lua_State *L)
+{
+  LazyContainer *container = luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  gint index = luaL_optinteger (L, 2, 0);
+  if (index >= lazy_length (container))
+    return 0;
+
+  lua_pushinteger (L, index + 1);
+  lazy_list_push (L, 1, container, index);
+  return 2;
+}
+
+/* Iterator of lazy hash table, proxy and iteration state are
+   upvalues. */
+static int
+lazy_hash_next (lua_State *L)
+{
+  LazyContainer *container = lua_touserdata (L, lua_upvalueindex (1));
+  LazyIter *iter = lua_touserdata (L, lua_upvalueindex (2));
+  gpointer key, value;
+  if (container->data == NULL
+      || !g_hash_table_iter_next (&iter->iter, &key, &value))
+    return 0;
+
+  lazy_hash_push (L, container, key, value);
+  return 2;
+}
+
+/* Iterator of ipairs() over the container, stopping at its end or at
+   the first nil element like ipairs() of plain tables does.  Hash
+   tables have no sequence part, so they are iterated as empty. */
+static int
+lazy_ipairs_next (lua_State *L)
+{
+  LazyContainer *container = lua_touserdata (L, 1);
+  lua_Integer index = luaL_checkinteger (L, 2) + 1;
+  if (container->tag == GI_TYPE_TAG_GHASH
+      || index > lazy_length (container))
+    return 0;
+
+  lua_pushinteger (L, index);
+  lazy_list_push (L, 1, container, index - 1);
+  return lua_isnil (L, -1) ? 0 : 2;
+}
+
+/* Implements __ipairs, iterating integer keys from 1. */
+static int
+lazy_ipairs (lua_State *L)
+{
+  luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  lua_pushcfunction (L, lazy_ipairs_next);
+  lua_pushvalue (L, 1);
+  lua_pushinteger (L, 0);
+  return 3;
+}
+
+/* Returns iterator over the elements of the container, usable also
+   where __pairs is not supported.  Lua prototype:
+   for key, value in container:pairs() do ... end */
+static int
+lazy_pairs (lua_State *L)
+{
+  LazyContainer *container = luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  LazyIter *iter;
+  if (container->tag != GI_TYPE_TAG_GHASH)
+    {
+      lua_pushcfunction (L, lazy_list_next);
+      lua_pushvalue (L, 1);
+      lua_pushinteger (L, 0);
+      return 3;
+    }
+
+  lua_pushvalue (L, 1);
+  iter = lua_newuserdata (L, sizeof (LazyIter));
+  if (container->data != NULL)
+    g_hash_table_iter_init (&iter->iter, container->data);
+  lua_pushcclosure (L, lazy_hash_next, 2);
+  return 1;
+}
+
+/* Converts the whole container to Lua table.  Lua prototype:
+   table = container:totable() */
+static int
+lazy_totable (lua_State *L)
+{
+  LazyContainer *container = luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  gint index, length = lazy_length (container);
+  if (container->tag != GI_TYPE_TAG_GHASH)
+    {
+      lua_createtable (L, length, 0);
+      for (index = 0; index < length; index++)
+	{
+	  lazy_list_push (L, 1, container, index);
+	  lua_rawseti (L, -2, index + 1);
+	}
+    }
+  else
+    {
+      GHashTableIter iter;
+      gpointer key, value;
+      lua_createtable (L, 0, length);
+      if (container->data != NULL)
+	{
+	  g_hash_table_iter_init (&iter, container->data);
+	  while (g_hash_table_iter_next (&iter, &key, &value))
+	    {
+	      lazy_hash_push (L, container, key, value);
+	      lua_settable (L, -3);
+	    }
+	}
+    }
+  return 1;
+}
+
+static int
+lazy_len (lua_State *L)
+{
+  LazyContainer *container = luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  lua_pushinteger (L, lazy_length (container));
+  return 1;
+}
+
+/* Pushes method of lazy container with name at index 2, or nil. */
+static int
+lazy_method (lua_State *L)
+{
+  lua_getmetatable (L, 1);
+  lua_pushvalue (L, 2);
+  lua_rawget (L, -2);
+  if (!lua_iscfunction (L, -1) || g_str_has_prefix (lua_tostring (L, 2), "__"))
+    lua_pushnil (L);
+  return 1;
+}
+
+/* Checks whether the value at narg can be a key of the hash table.
+   Values of other types are never present in it, e.g. integer
+   indices used by ipairs() in tables keyed by objects. */
+static gboolean
+lazy_hash_key_test (lua_State *L, LazyContainer *container, int narg)
+{
+  GIBaseInfo *info;
+  gboolean scalar;
+  if (gi_type_info_get_tag (container->eti[0]) != GI_TYPE_TAG_INTERFACE
+      || lua_isuserdata (L, narg))
+    return TRUE;
+
+  info = gi_type_info_get_interface (container->eti[0]);
+  scalar = GI_IS_ENUM_INFO (info) || GI_IS_FLAGS_INFO (info);
+  gi_base_info_unref (info);
+  return scalar;
+}
+
+static int
+lazy_index (lua_State *L)
+{
+  LazyContainer *container = luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  if (container->tag != GI_TYPE_TAG_GHASH)
+    {
+      lua_Integer index = lua_tointeger (L, 2);
+      if (index > 0 && index <= lazy_length (container))
+	lazy_list_push (L, 1, container, index - 1);
+      else if (lua_type (L, 2) == LUA_TSTRING)
+	return lazy_method (L);
+      else
+	lua_pushnil (L);
+    }
+  else
+    {
+      gpointer key, value;
+      GITypeTag ktag = gi_type_info_get_tag (container->eti[0]);
+      gboolean string_keys = (ktag == GI_TYPE_TAG_UTF8
+			      || ktag == GI_TYPE_TAG_FILENAME);
+      if (container->data == NULL
+	  || (lua_type (L, 2) == LUA_TSTRING && !string_keys))
+	return lazy_method (L);
+      if (!lazy_hash_key_test (L, container, 2))
+	{
+	  lua_pushnil (L);
+	  return 1;
+	}
+
+      /* Marshal the key to C and look it up using the hash function
+	 of the table. */
+      lua_gobject_marshal_2c (L, container->eti[0], NULL,
+			      GI_TRANSFER_NOTHING, &key, 2,
+			      LUA_GOBJECT_PARENT_FORCE_POINTER, NULL, NULL, FALSE);
+      if (g_hash_table_lookup_extended (container->data, key, NULL, &value))
+	{
+	  GIArgument eval;
+	  eval.v_pointer = value;
+	  lua_gobject_marshal_2lua (L, container->eti[1], NULL,
+				    container->dir, GI_TRANSFER_NOTHING,
+				    &eval, LUA_GOBJECT_PARENT_FORCE_POINTER,
+				    NULL, NULL);
+	}
+      else if (string_keys)
+	lazy_method (L);
+      else
+	lua_pushnil (L);
+      lua_replace (L, 2);
+      lua_settop (L, 2);
+    }
+  return 1;
+}
+
+/* Stores element of builder container.  Lists and pointer arrays
+   can be appended to by storing at index #container + 1. */
+static int
+lazy_newindex (lua_State *L)
+{
+  LazyContainer *container = luaL_checkudata (L, 1, UD_LAZY_CONTAINER);
+  if (!container->builder)
+    return luaL_error (L, "container returned from C is read-only");
+  if (container->given_away)
+    return luaL_error (L, "container was given away");
+
+  if (container->tag == GI_TYPE_TAG_GHASH && lua_isnil (L, 3))
+    {
+      /* Assigning nil removes the entry, like in Lua tables. */
+      gpointer key;
+      lua_gobject_marshal_2c (L, container->eti[0], NULL,
+			      GI_TRANSFER_NOTHING, &key, 2,
+			      LUA_GOBJECT_PARENT_FORCE_POINTER, NULL, NULL, FALSE);
+      g_hash_table_remove (container->data, key);
+      lua_settop (L, 3);
+    }
+  else if (container->tag == GI_TYPE_TAG_GHASH)
+    {
+      gpointer key = lazy_element_2c (L, container->eti[0], 2);
+      g_hash_table_replace (container->data, key,
+			    lazy_element_2c (L, container->eti[1], 3));
+    }
+  else
+    {
+      gint length = lazy_length (container);
+      lua_Integer index = luaL_checkinteger (L, 2);
+      gpointer value;
+      luaL_argcheck (L, index > 0 && index <= length + 1, 2, "bad index");
+      value = lazy_element_2c (L, container->eti[0], 3);
+      if (index <= length)
+	{
+	  /* Replace the element and forget cached Lua value. */
+	  gpointer *element = lazy_element (container, index - 1);
+	  if (container->free_elt != NULL && *element != NULL)
+	    container->free_elt (*element);
+	  *element = value;
+	  lua_getfenv (L, 1);
+	  lua_pushnil (L);
+	  lua_rawseti (L, -2, index);
+	}
+      else if (container->tag == GI_TYPE_TAG_ARRAY)
+	g_ptr_array_add (container->data, value);
+      else
+	{
+	  /* Link new node after the last one. */
+	  GSList *node;
+	  if (container->tag == GI_TYPE_TAG_GSLIST)
+	    node = g_slist_prepend (NULL, value);
+	  else
+	    {
+	      node = (GSList *) g_list_prepend (NULL, value);
+	      ((GList *) node)->prev = (GList *) container->last;
+	    }
+	  if (container->last != NULL)
+	    container->last->next = node;
+	  else
+	    container->data = node;
+	  container->last = node;
+	  container->length = length + 1;
+	}
+    }
+  return 0;
+}
+
+/* Stores function freeing owned element of given type, NULL for
+   scalar types.  Returns FALSE for types whose elements cannot be
+   freed without marshalling them. */
+static gboolean
+lazy_elt_free (GITypeInfo *eti, GDestroyNotify *free_elt)
+{
+  *free_elt = NULL;
+  switch (gi_type_info_get_tag (eti))
+    {
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_UNICHAR:
+    case GI_TYPE_TAG_GTYPE:
+      return TRUE;
+
+    case GI_TYPE_TAG_UTF8:
+    case GI_TYPE_TAG_FILENAME:
+      *free_elt = g_free;
+      return TRUE;
+
+    case GI_TYPE_TAG_INTERFACE:
+      {
+	GIBaseInfo *info = gi_type_info_get_interface (eti);
+	gboolean scalar = GI_IS_ENUM_INFO (info);
+	gboolean object = (GI_IS_INTERFACE_INFO (info)
+			   || (GI_IS_OBJECT_INFO (info)
+			       && g_type_is_a (gi_registered_type_info_get_g_type
+					       (GI_REGISTERED_TYPE_INFO (info)),
+					       G_TYPE_OBJECT)));
+	gi_base_info_unref (info);
+	if (object)
+	  *free_elt = g_object_unref;
+	return scalar || object;
+      }
+
+    default:
+      return FALSE;
+    }
+}
+
+static int
+lazy_gc (lua_State *L)
+{
+  LazyContainer *container = lua_touserdata (L, 1);
+  GSList *node;
+  gint index;
+
+  if (container->data == NULL)
+    ;
+  else if (container->tag == GI_TYPE_TAG_GHASH)
+    g_hash_table_unref (container->data);
+  else if (container->tag == GI_TYPE_TAG_ARRAY)
+    g_ptr_array_unref (container->data);
+  else
+    {
+      /* Release elements which were never accessed, directly when
+	 their type allows it, otherwise by taking them over. */
+      if (container->xfer == GI_TRANSFER_EVERYTHING)
+	{
+	  GDestroyNotify free_elt;
+	  gboolean direct = lazy_elt_free (container->eti[0], &free_elt);
+	  lua_getfenv (L, 1);
+	  for (node = container->data, index = 1; node != NULL;
+	       node = g_slist_next (node), index++)
+	    {
+	      lua_rawgeti (L, -1, index);
+	      if (!lua_isnil (L, -1) || node->data == NULL)
+		;
+	      else if (direct)
+		{
+		  if (free_elt != NULL)
+		    free_elt (node->data);
+		}
+	      else
+		lua_gobject_marshal_2lua (L, container->eti[0], NULL,
+					  container->dir,
+					  GI_TRANSFER_EVERYTHING, &node->data,
+					  LUA_GOBJECT_PARENT_FORCE_POINTER,
+					  NULL, NULL);
+	      lua_settop (L, 2);
+	    }
+	}
+
+      if (container->free_elt == NULL)
+	{
+	  if (container->tag == GI_TYPE_TAG_GSLIST)
+	    g_slist_free (container->data);
+	  else
+	    g_list_free (container->data);
+	}
+      else if (container->tag == GI_TYPE_TAG_GSLIST)
+	g_slist_free_full (container->data, container->free_elt);
+      else
+	g_list_free_full (container->data, container->free_elt);
+    }
+
+  for (index = 0; index < 2; index++)
+    if (container->eti[index] != NULL)
+      gi_base_info_unref (container->eti[index]);
+  container->data = NULL;
+  return 0;
+}
+
+static const luaL_Reg lazy_reg[] = {
+  { "__index", lazy_index },
+  { "__newindex", lazy_newindex },
+  { "__len", lazy_len },
+  { "__gc", lazy_gc },
+  { "__pairs", lazy_pairs },
+  { "__ipairs", lazy_ipairs },
+  { "pairs", lazy_pairs },
+  { "totable", lazy_totable },
+  { NULL, NULL }
+};
+
+static LazyContainer *
+lazy_new (lua_State *L, GITypeTag tag, GITypeInfo **eti,
+	  GIDirection dir, GITransfer xfer, gpointer data)
+{
+  LazyContainer *container = lua_newuserdata (L, sizeof (LazyContainer));
+  gint i;
+  container->data = data;
+  container->last = NULL;
+  for (i = 0; i < 2; i++)
+    container->eti[i] = eti[i];
+  container->free_elt = NULL;
+  container->tag = tag;
+  container->dir = dir;
+  container->xfer = xfer;
+  container->builder = FALSE;
+  container->taken = FALSE;
+  container->given_away = FALSE;
+  container->cursor = NULL;
+  container->cursor_index = 0;
+  container->length = -1;
+  luaL_getmetatable (L, UD_LAZY_CONTAINER);
+  lua_setmetatable (L, -2);
+  lua_newtable (L);
+  lua_setfenv (L, -2);
+  return container;
+}
+
+/* Checks whether elements of list of given type returned with
+   container transfer are all objects, and if yes, references them, so
+   that the list can be treated as returned with full transfer. */
+static gboolean
+lazy_own_objects (GITypeInfo *eti, GSList *list)
+{
+  GIBaseInfo *info;
+  gboolean objects;
+  GSList *node;
+
+  if (gi_type_info_get_tag (eti) != GI_TYPE_TAG_INTERFACE)
+    return FALSE;
+  info = gi_type_info_get_interface (eti);
+  objects = GI_IS_OBJECT_INFO (info) || GI_IS_INTERFACE_INFO (info);
+  gi_base_info_unref (info);
+  for (node = list; objects && node != NULL; node = g_slist_next (node))
+    objects = (node->data == NULL || G_IS_OBJECT (node->data));
+  if (!objects)
+    return FALSE;
+
+  for (node = list; node != NULL; node = g_slist_next (node))
+    if (node->data != NULL)
+      g_object_ref (node->data);
+  return TRUE;
+}
+
+gboolean
+lua_gobject_marshal_2lua_lazy (lua_State *L, GITypeInfo *ti,
+			       GIDirection dir, GITransfer xfer,
+			       gpointer data)
+{
+  GITypeTag tag = gi_type_info_get_tag (ti);
+  GITypeInfo *eti[2] = { NULL, NULL };
+
+  /* Elements borrowed from the callee could be freed before they
+     are accessed, so only containers owned by the caller can be
+     lazy. */
+  if (xfer == GI_TRANSFER_NOTHING)
+    return FALSE;
+
+  eti[0] = gi_type_info_get_param_type (ti, 0);
+  if (tag == GI_TYPE_TAG_GHASH)
+    {
+      /* Only keys which can be marshalled into pointer can be looked
+	 up; hash tables with container transfer borrow elements. */
+      GITypeTag ktag = gi_type_info_get_tag (eti[0]);
+      if (data == NULL || xfer != GI_TRANSFER_EVERYTHING
+	  || ktag == GI_TYPE_TAG_INT64 || ktag == GI_TYPE_TAG_UINT64
+	  || ktag == GI_TYPE_TAG_FLOAT || ktag == GI_TYPE_TAG_DOUBLE)
+	{
+	  gi_base_info_unref (eti[0]);
+	  return FALSE;
+	}
+      eti[1] = gi_type_info_get_param_type (ti, 1);
+    }
+  else if (xfer == GI_TRANSFER_CONTAINER)
+    {
+      if (!lazy_own_objects (eti[0], data))
+	{
+	  gi_base_info_unref (eti[0]);
+	  return FALSE;
+	}
+      xfer = GI_TRANSFER_EVERYTHING;
+    }
+
+  lazy_new (L, tag, eti, dir, xfer, data);
+  return TRUE;
+}
+
+/* Returns function freeing elements of given type owned by builder
+   container, raising an error for types which cannot be owned. */
+static GDestroyNotify
+container_elt_free (lua_State *L, GITypeInfo *eti, int narg)
+{
+  GDestroyNotify free_elt;
+  if (!lazy_elt_free (eti, &free_elt))
+    luaL_argerror (L, narg, "unsupported element type");
+  return free_elt;
+}
+
+/* Creates empty builder container of given tag. */
+static int
+container_new (lua_State *L, GITypeTag tag)
+{
+  GITypeInfo *eti[2] = { NULL, NULL };
+  GDestroyNotify free_elt[2] = { NULL, NULL };
+  LazyContainer *container;
+  gpointer data = NULL;
+  gint i;
+
+  for (i = 0; i < (tag == GI_TYPE_TAG_GHASH ? 2 : 1); i++)
+    {
+      eti[i] = *(GITypeInfo **) luaL_checkudata (L, i + 1,
+						 LUA_GOBJECT_GI_INFO);
+      luaL_argcheck (L, GI_IS_TYPE_INFO (eti[i]), i + 1,
+		     "typeinfo expected");
+      free_elt[i] = container_elt_free (L, eti[i], i + 1);
+    }
+
+  if (tag == GI_TYPE_TAG_GHASH)
+    {
+      /* Strings are hashed by value, everything else directly. */
+      GITypeTag ktag = gi_type_info_get_tag (eti[0]);
+      gboolean string_keys = (ktag == GI_TYPE_TAG_UTF8
+			      || ktag == GI_TYPE_TAG_FILENAME);
+      data = g_hash_table_new_full (string_keys ? g_str_hash : NULL,
+				    string_keys ? g_str_equal : NULL,
+				    free_elt[0], free_elt[1]);
+    }
+  else if (tag == GI_TYPE_TAG_ARRAY)
+    data = g_ptr_array_new_with_free_func (free_elt[0]);
+
+  for (i = 0; i < 2; i++)
+    if (eti[i] != NULL)
+      gi_base_info_ref (eti[i]);
+  container = lazy_new (L, tag, eti, GI_DIRECTION_IN,
+			GI_TRANSFER_NOTHING, data);
+  container->free_elt = free_elt[0];
+  container->builder = TRUE;
+  container->length = 0;
+  return 1;
+}
+
+/* Creates empty containers, filled from Lua and passed to C without
+   conversion.  Lua prototypes:
+   list = core.container.list(elttype)
+   slist = core.container.slist(elttype)
+   array = core.container.ptrarray(elttype)
+   hash = core.container.hash(keytype, valuetype) */
+static int
+container_list (lua_State *L)
+{
+  return container_new (L, GI_TYPE_TAG_GLIST);
+}
+
+static int
+container_slist (lua_State *L)
+{
+  return container_new (L, GI_TYPE_TAG_GSLIST);
+}
+
+static int
+container_ptrarray (lua_State *L)
+{
+  return container_new (L, GI_TYPE_TAG_ARRAY);
+}
+
+static int
+container_hash (lua_State *L)
+{
+  return container_new (L, GI_TYPE_TAG_GHASH);
+}
+
+static const luaL_Reg container_api_reg[] = {
+  { "list", container_list },
+  { "slist", container_slist },
+  { "ptrarray", container_ptrarray },
+  { "hash", container_hash },
+  { NULL, NULL }
+};
+
+/* Checks whether element types of containers are the same. */
+static gboolean
+lazy_type_equal (GITypeInfo *ti1, GITypeInfo *ti2)
+{
+  GITypeTag tag = gi_type_info_get_tag (ti1);
+  gboolean equal;
+  GIBaseInfo *info1, *info2;
+  if (tag != gi_type_info_get_tag (ti2))
+    return FALSE;
+  else if (tag == GI_TYPE_TAG_ARRAY || tag == GI_TYPE_TAG_GLIST
+	   || tag == GI_TYPE_TAG_GSLIST || tag == GI_TYPE_TAG_GHASH)
+    return FALSE;
+  else if (tag != GI_TYPE_TAG_INTERFACE)
+    return TRUE;
+
+  info1 = gi_type_info_get_interface (ti1);
+  info2 = gi_type_info_get_interface (ti2);
+  equal = gi_base_info_equal (info1, info2);
+  gi_base_info_unref (info1);
+  gi_base_info_unref (info2);
+  return equal;
+}
+
+/* Tries to pass native container at narg to C directly.  Returns
+   FALSE if narg is not a native container or it cannot be passed
+   as-is. */
+static gboolean
+lazy_2c (lua_State *L, int narg, GITypeInfo *ti, GITypeTag tag,
+	 GITransfer transfer, gpointer *data)
+{
+  LazyContainer *container = lua_gobject_udata_test (L, narg,
+						     UD_LAZY_CONTAINER);
+  GITypeInfo *eti;
+  gboolean equal;
+  gint i;
+
+  /* Container with taken elements contains dangling pointers, and
+     container transfer would need to copy elements. */
+  if (container == NULL || container->tag != tag || container->data == NULL
+      || container->taken || transfer == GI_TRANSFER_CONTAINER)
+    return FALSE;
+
+  for (i = 0; i < (tag == GI_TYPE_TAG_GHASH ? 2 : 1); i++)
+    {
+      eti = gi_type_info_get_param_type (ti, i);
+      equal = lazy_type_equal (eti, container->eti[i]);
+      gi_base_info_unref (eti);
+      if (!equal)
+	return FALSE;
+    }
+
+  *data = container->data;
+  if (transfer == GI_TRANSFER_EVERYTHING)
+    {
+      /* Callee takes the container, proxy becomes empty. */
+      container->data = NULL;
+      container->last = NULL;
+      container->cursor = NULL;
+      container->length = 0;
+      container->given_away = TRUE;
+      lua_newtable (L);
+      lua_setfenv (L, narg);
+    }
+  return TRUE;
+}
+
+/* If narg is native container which could not be passed directly,
+   pushes its contents converted to table and returns TRUE. */
+static gboolean
+lazy_push_table (lua_State *L, int narg)
+{
+  if (lua_gobject_udata_test (L, narg, UD_LAZY_CONTAINER) == NULL)
+    return FALSE;
+
+  lua_pushcfunction (L, lazy_totable);
+  lua_pushvalue (L, narg);
+  lua_call (L, 1, 1);
+  return TRUE;
+}
+
 static void
 marshal_2lua_error (lua_State *L, GITransfer xfer, GError *err)
 {
@@ -847,11 +1879,12 @@ marshal_2lua_error (lua_State *L, GITransfer xfer, GError *err)
     }
 }
 
-/* Marshalls given callable from Lua to C. */
+/* Marshalls given callable from Lua to C.  When in_call is set,
+   scope=call closure block is released by the arena of the call. */
 static int
 marshal_2c_callable (lua_State *L, GICallableInfo *ci, GIArgInfo *ai,
 		     gpointer *callback, int narg, gboolean optional,
-		     GICallableInfo *argci, void **args)
+		     GICallableInfo *argci, void **args, gboolean in_call)
 {
   int nret = 0;
   GIScopeType scope;
@@ -913,16 +1946,14 @@ marshal_2c_callable (lua_State *L, GICallableInfo *ci, GIArgInfo *ai,
 	 setup destruction according to scope. */
       user_data = lua_gobject_closure_allocate (L, 1);
       if (scope == GI_SCOPE_TYPE_CALL)
-	{
-	  *lua_gobject_guard_create (L, lua_gobject_closure_destroy) = user_data;
-	  nret++;
-	}
+	*lua_gobject_arena_guard (L, in_call, lua_gobject_closure_release,
+				  &nret) = user_data;
       else
 	g_assert (scope == GI_SCOPE_TYPE_ASYNC);
     }
 
   /* Create the closure. */
-  lua_gobject_callable_create (L, ci, NULL);
+  lua_gobject_callable_create_callback (L, ci);
   *callback = lua_gobject_closure_create (L, user_data, narg,
 				  scope == GI_SCOPE_TYPE_ASYNC);
   return nret;
@@ -932,12 +1963,15 @@ marshal_2c_callable (lua_State *L, GICallableInfo *ci, GIArgInfo *ai,
 int
 lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 		GITransfer transfer, gpointer target, int narg,
-		int parent, GICallableInfo *ci, void **args)
+		int parent, GICallableInfo *ci, void **args,
+		gboolean in_call)
 {
   int nret = 0;
   gboolean optional = (parent == LUA_GOBJECT_PARENT_CALLER_ALLOC) ||
     (ai == NULL || (gi_arg_info_is_optional (ai) ||
 		        gi_arg_info_may_be_null (ai)));
+  gboolean writable = (parent == LUA_GOBJECT_PARENT_CALLER_ALLOC) ||
+    (ai != NULL && gi_arg_info_get_direction (ai) != GI_DIRECTION_IN);
   GITypeTag tag = gi_type_info_get_tag (ti);
   GIArgument *arg = target;
 
@@ -992,7 +2026,8 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 	else if (!optional || (type != LUA_TNIL && type != LUA_TNONE))
 	{
 	  if (type == LUA_TUSERDATA)
-	    str = (gchar *) lua_gobject_udata_test (L, narg, LUA_GOBJECT_BYTES_BUFFER);
+	    str = writable ? lua_gobject_buffer_test_writable (L, narg, NULL)
+	      : lua_gobject_buffer_test (L, narg, NULL);
 	  if (str == NULL)
 	    str = (gchar *) luaL_checkstring (L, narg);
 	}
@@ -1005,10 +2040,10 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 		str = g_filename_from_utf8 (str, -1, NULL, NULL, NULL);
 		if (transfer != GI_TRANSFER_EVERYTHING)
 		  {
-		    /* Create temporary object on the stack which will
-		       destroy the allocated temporary filename. */
-		    *lua_gobject_guard_create (L, g_free) = (gpointer) str;
-		    nret = 1;
+		    /* Create temporary which will destroy the allocated
+		       temporary filename. */
+		    *lua_gobject_arena_guard (L, in_call, g_free,
+					      &nret) = (gpointer) str;
 		  }
 	      }
 	  }
@@ -1024,9 +2059,12 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
     case GI_TYPE_TAG_INTERFACE:
       {
 	GIBaseInfo *info = gi_type_info_get_interface (ti);
-	int info_guard;
-	lua_gobject_gi_info_new (L, info);
-	info_guard = lua_gettop (L);
+	int info_guard = 0;
+	*lua_gobject_arena_guard (L, in_call,
+				  (GDestroyNotify) gi_base_info_unref,
+				  &info_guard) = info;
+	if (info_guard)
+	  info_guard = lua_gettop (L);
 
         if (GI_IS_ENUM_INFO (info) || GI_IS_FLAGS_INFO (info))
           {
@@ -1041,7 +2079,7 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 	      }
 
 	    /* Directly store underlying value. */
-	    marshal_2c_int (L, gi_enum_info_get_storage_type (GI_ENUM_INFO (info)), arg, narg,
+	    lua_gobject_marshal_2c_int (L, gi_enum_info_get_storage_type (GI_ENUM_INFO (info)), arg, narg,
 			    optional, parent);
 
 	    /* Remove the temporary value, to keep stack balanced. */
@@ -1079,14 +2117,15 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
         else if (GI_IS_CALLBACK_INFO (info))
           {
 	    nret = marshal_2c_callable (L, GI_CALLABLE_INFO (info), ai, &arg->v_pointer, narg,
-					optional, ci, args);
+					optional, ci, args, in_call);
           }
         else
           {
 	    g_assert_not_reached ();
           }
 
-	lua_remove (L, info_guard);
+	if (info_guard)
+	  lua_remove (L, info_guard);
       }
       break;
 
@@ -1095,7 +2134,7 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 	gssize size;
 	GIArrayType atype = gi_type_info_get_array_type (ti);
 	nret = marshal_2c_array (L, ti, atype, &arg->v_pointer, &size,
-				 narg, optional, transfer);
+				 narg, optional, writable, transfer, in_call);
 
 	/* Fill in array length argument, if it is specified. */
 	if (atype == GI_ARRAY_TYPE_C)
@@ -1105,12 +2144,13 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 
     case GI_TYPE_TAG_GLIST:
     case GI_TYPE_TAG_GSLIST:
-      nret = marshal_2c_list (L, ti, tag, &arg->v_pointer, narg, transfer);
+      nret = marshal_2c_list (L, ti, tag, &arg->v_pointer, narg, transfer,
+			      in_call);
       break;
 
     case GI_TYPE_TAG_GHASH:
       nret = marshal_2c_hash (L, ti, (GHashTable **) &arg->v_pointer, narg,
-			      optional, transfer);
+			      optional, transfer, in_call);
       break;
 
     case GI_TYPE_TAG_VOID:
@@ -1131,8 +2171,12 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
 		arg->v_pointer = lua_touserdata (L, narg);
 	      else
 		{
-		  /* Check memory buffer. */
-		  arg->v_pointer = lua_gobject_udata_test (L, narg, LUA_GOBJECT_BYTES_BUFFER);
+		  /* Check memory buffer; C code can write through
+		     output or caller-allocated generic pointer, so
+		     it has to be writable then. */
+		  arg->v_pointer = writable
+		    ? lua_gobject_buffer_test_writable (L, narg, NULL)
+		    : lua_gobject_buffer_test (L, narg, NULL);
 		  if (!arg->v_pointer)
 		    {
 		      /* Check object. */
@@ -1152,7 +2196,7 @@ lua_gobject_marshal_2c (lua_State *L, GITypeInfo *ti, GIArgInfo *ai,
       break;
 
     default:
-      marshal_2c_int (L, tag, arg, narg, optional, parent);
+      lua_gobject_marshal_2c_int (L, tag, arg, narg, optional, parent);
     }
 
   return nret;
@@ -1316,7 +2360,7 @@ lua_gobject_marshal_2lua (lua_State *L, GITypeInfo *ti, GIArgInfo *ai, GIDirecti
 	    lua_gobject_type_get_repotype (L, G_TYPE_INVALID, info);
 
 	    /* Unmarshal the numeric value. */
-	    marshal_2lua_int (L, gi_enum_info_get_storage_type (GI_ENUM_INFO (info)),
+	    lua_gobject_marshal_2lua_int (L, gi_enum_info_get_storage_type (GI_ENUM_INFO (info)),
 			      arg, parent);
 
 	    /* Get symbolic value from the table. */
@@ -1396,7 +2440,7 @@ lua_gobject_marshal_2lua (lua_State *L, GITypeInfo *ti, GIArgInfo *ai, GIDirecti
       break;
 
     default:
-      marshal_2lua_int (L, tag, arg, parent);
+      lua_gobject_marshal_2lua_int (L, tag, arg, parent);
     }
 }
 
@@ -1523,7 +2567,7 @@ lua_gobject_marshal_field (lua_State *L, gpointer object, gboolean getmode,
 
 		/* Use typeinfo to marshal the numeric value. */
 		lua_gobject_marshal_2c (L, ti, NULL, GI_TRANSFER_NOTHING, field_addr,
-				val_arg, 0, NULL, NULL);
+				val_arg, 0, NULL, NULL, FALSE);
 		lua_pop (L, 2);
 		return 0;
 	      }
@@ -1544,7 +2588,7 @@ lua_gobject_marshal_field (lua_State *L, gpointer object, gboolean getmode,
   else
     {
       lua_gobject_marshal_2c (L, ti, NULL, GI_TRANSFER_EVERYTHING, field_addr, val_arg,
-		      0, NULL, NULL);
+		      0, NULL, NULL, FALSE);
       nret = 0;
     }
 
@@ -1623,7 +2667,7 @@ marshal_container_marshaller (lua_State *L)
 	else
 	  {
 	    nret = marshal_2c_array (L, *ti, atype, &data, &size, 3, FALSE,
-				     transfer);
+				     FALSE, transfer, FALSE);
 	    if (lua_type (L, 2) == LUA_TTABLE)
 	      {
 		lua_pushinteger (L, size);
@@ -1638,7 +2682,7 @@ marshal_container_marshaller (lua_State *L)
       if (get_mode)
 	marshal_2lua_list (L, *ti, GI_DIRECTION_OUT, tag, transfer, data);
       else
-	nret = marshal_2c_list (L, *ti, tag, &data, 3, transfer);
+	nret = marshal_2c_list (L, *ti, tag, &data, 3, transfer, FALSE);
       break;
 
     case GI_TYPE_TAG_GHASH:
@@ -1646,7 +2690,7 @@ marshal_container_marshaller (lua_State *L)
 	marshal_2lua_hash (L, *ti, GI_DIRECTION_OUT, transfer, data);
       else
 	nret = marshal_2c_hash (L, *ti, (GHashTable **) &data, 3, FALSE,
-				transfer);
+				transfer, FALSE);
       break;
 
     default:
@@ -1805,7 +2849,7 @@ marshal_argument (lua_State *L)
   else
     {
       lua_pop (L, lua_gobject_marshal_2c (L, *info, NULL, transfer, arg, 4,
-				  0, NULL, NULL));
+				  0, NULL, NULL, FALSE));
       return 0;
     }
 }
@@ -1837,6 +2881,298 @@ gclosure_destroy (gpointer user_data, GClosure *closure)
   lua_gobject_closure_destroy (user_data);
 }
 
+/* Pushes GObject.Value proxy of given GValue. */
+static void
+marshal_value_proxy (lua_State *L, const GValue *value)
+{
+  lua_gobject_type_get_repotype (L, G_TYPE_VALUE, NULL);
+  lua_gobject_record_2lua (L, (gpointer) value, FALSE, 0);
+}
+
+void
+lua_gobject_marshal_value_2c (lua_State *L, int narg, GValue *value,
+			      GType fundamental)
+{
+  GIArgument arg;
+  lua_gobject_makeabs (L, narg);
+  if (fundamental == G_TYPE_INVALID)
+    fundamental = G_TYPE_FUNDAMENTAL (G_VALUE_TYPE (value));
+  switch (fundamental)
+    {
+#define HANDLE_INT(gtype, tag, member, setter)				\
+      case G_TYPE_ ## gtype:						\
+	lua_gobject_marshal_2c_int (L, GI_TYPE_TAG_ ## tag, &arg, narg,	\
+				    FALSE, 0);				\
+	g_value_set_ ## setter (value, arg.v_ ## member);		\
+	return
+
+      HANDLE_INT (CHAR, INT8, int8, schar);
+      HANDLE_INT (UCHAR, UINT8, uint8, uchar);
+      HANDLE_INT (INT, INT32, int32, int);
+      HANDLE_INT (UINT, UINT32, uint32, uint);
+      HANDLE_INT (LONG, INT64, int64, long);
+      HANDLE_INT (ULONG, UINT64, uint64, ulong);
+      HANDLE_INT (INT64, INT64, int64, int64);
+      HANDLE_INT (UINT64, UINT64, uint64, uint64);
+#undef HANDLE_INT
+
+    case G_TYPE_BOOLEAN:
+      g_value_set_boolean (value, lua_toboolean (L, narg));
+      return;
+
+    case G_TYPE_FLOAT:
+      g_value_set_float (value, (gfloat) luaL_checknumber (L, narg));
+      return;
+
+    case G_TYPE_DOUBLE:
+      g_value_set_double (value, luaL_checknumber (L, narg));
+      return;
+
+    case G_TYPE_STRING:
+      g_value_set_string (value, lua_isnoneornil (L, narg)
+			  ? NULL : luaL_checkstring (L, narg));
+      return;
+
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+      if (lua_type (L, narg) == LUA_TNUMBER)
+	lua_pushvalue (L, narg);
+      else
+	{
+	  /* Let the enum/bitflags type convert symbolic value. */
+	  lua_gobject_type_get_repotype (L, G_VALUE_TYPE (value), NULL);
+	  lua_pushvalue (L, narg);
+	  lua_call (L, 1, 1);
+	}
+      if (fundamental == G_TYPE_ENUM)
+	g_value_set_enum (value, (gint) lua_tointeger (L, -1));
+      else
+	g_value_set_flags (value, (guint) lua_tonumber (L, -1));
+      lua_pop (L, 1);
+      return;
+
+    case G_TYPE_INTERFACE:
+      if (!g_type_is_a (G_VALUE_TYPE (value), G_TYPE_OBJECT))
+	break;
+      /* Fall through. */
+    case G_TYPE_OBJECT:
+      g_value_set_object (value, lua_gobject_object_2c (L, narg,
+							G_VALUE_TYPE (value),
+							TRUE, FALSE, FALSE));
+      return;
+
+    default:
+      break;
+    }
+
+  /* Generic fallback through 'value' attribute of GObject.Value. */
+  marshal_value_proxy (L, value);
+  lua_pushvalue (L, narg);
+  lua_setfield (L, -2, "value");
+  lua_pop (L, 1);
+}
+
+void
+lua_gobject_marshal_value_2lua (lua_State *L, const GValue *value,
+				GType fundamental)
+{
+  GIArgument arg;
+  if (fundamental == G_TYPE_INVALID)
+    fundamental = G_TYPE_FUNDAMENTAL (G_VALUE_TYPE (value));
+  switch (fundamental)
+    {
+#define HANDLE_INT(gtype, tag, member, getter)				\
+      case G_TYPE_ ## gtype:						\
+	arg.v_ ## member = g_value_get_ ## getter (value);		\
+	lua_gobject_marshal_2lua_int (L, GI_TYPE_TAG_ ## tag, &arg, 0);	\
+	return
+
+      HANDLE_INT (CHAR, INT8, int8, schar);
+      HANDLE_INT (UCHAR, UINT8, uint8, uchar);
+      HANDLE_INT (INT, INT32, int32, int);
+      HANDLE_INT (UINT, UINT32, uint32, uint);
+      HANDLE_INT (LONG, INT64, int64, long);
+      HANDLE_INT (ULONG, UINT64, uint64, ulong);
+      HANDLE_INT (INT64, INT64, int64, int64);
+      HANDLE_INT (UINT64, UINT64, uint64, uint64);
+#undef HANDLE_INT
+
+    case G_TYPE_BOOLEAN:
+      lua_pushboolean (L, g_value_get_boolean (value));
+      return;
+
+    case G_TYPE_FLOAT:
+      lua_pushnumber (L, g_value_get_float (value));
+      return;
+
+    case G_TYPE_DOUBLE:
+      lua_pushnumber (L, g_value_get_double (value));
+      return;
+
+    case G_TYPE_STRING:
+      lua_pushstring (L, g_value_get_string (value));
+      return;
+
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+      /* Enum/bitflags type maps numeric value to symbolic one. */
+      lua_gobject_type_get_repotype (L, G_VALUE_TYPE (value), NULL);
+      if (fundamental == G_TYPE_ENUM)
+	lua_pushinteger (L, g_value_get_enum (value));
+      else
+	lua_pushnumber (L, g_value_get_flags (value));
+      if (lua_isnil (L, -2))
+	lua_replace (L, -2);
+      else
+	lua_gettable (L, -2);
+      return;
+
+    case G_TYPE_INTERFACE:
+      if (!g_type_is_a (G_VALUE_TYPE (value), G_TYPE_OBJECT))
+	break;
+      /* Fall through. */
+    case G_TYPE_OBJECT:
+      lua_gobject_object_2lua (L, g_value_get_object (value), FALSE, FALSE);
+      return;
+
+    case G_TYPE_BOXED:
+      {
+	gpointer boxed = g_value_get_boxed (value);
+	if (boxed == NULL)
+	  {
+	    lua_pushnil (L);
+	    return;
+	  }
+	lua_gobject_type_get_repotype (L, G_VALUE_TYPE (value), NULL);
+	if (lua_isnil (L, -1))
+	  {
+	    lua_pop (L, 1);
+	    break;
+	  }
+	lua_gobject_record_2lua (L, boxed, FALSE, 0);
+	return;
+      }
+
+    default:
+      break;
+    }
+
+  /* Generic fallback through 'value' attribute of GObject.Value. */
+  marshal_value_proxy (L, value);
+  lua_getfield (L, -1, "value");
+  lua_replace (L, -2);
+}
+
+/* Lua target of GClosure marshalled natively by
+   marshal_gclosure_marshal(). */
+typedef struct _MarshalGClosure
+{
+  /* Thread which created the closure and per-state block. */
+  lua_State *L;
+  LuaGObjectState *state;
+
+  /* Closure store slots anchoring the thread and keeping the Lua
+     target to be invoked. */
+  int thread_ref;
+  int target_ref;
+
+  /* Signature plan: fundamental types of the parameters and of the
+     return value (G_TYPE_NONE if it is not marshalled). */
+  GType ret;
+  guint n_params;
+  GType params[1];
+} MarshalGClosure;
+
+/* Arguments of single native closure invocation. */
+typedef struct _MarshalGClosureCall
+{
+  MarshalGClosure *target;
+  GValue *return_value;
+  guint n_param_values;
+  const GValue *param_values;
+} MarshalGClosureCall;
+
+/* Invokes Lua target of the native closure, run in protected mode so
+   that errors do not escape back to the C code emitting the signal. */
+static int
+marshal_gclosure_call (lua_State *L)
+{
+  MarshalGClosureCall *call = lua_touserdata (L, 1);
+  MarshalGClosure *target = call->target;
+  guint i;
+
+  /* Lua target is already on the stack, push its arguments. */
+  luaL_checkstack (L, call->n_param_values + 2, "");
+  for (i = 0; i < call->n_param_values; i++)
+    lua_gobject_marshal_value_2lua (L, &call->param_values[i],
+				    i < target->n_params
+				    ? target->params[i] : G_TYPE_INVALID);
+  lua_call (L, call->n_param_values, 1);
+  if (call->return_value != NULL && target->ret != G_TYPE_NONE
+      && G_IS_VALUE (call->return_value))
+    lua_gobject_marshal_value_2c (L, -1, call->return_value, target->ret);
+  return 0;
+}
+
+/* GClosureMarshal converting parameters directly onto the Lua stack
+   according to signature plan compiled when the closure was
+   created. */
+static void
+marshal_gclosure_marshal (GClosure *closure, GValue *return_value,
+			  guint n_param_values, const GValue *param_values,
+			  gpointer invocation_hint, gpointer marshal_data)
+{
+  MarshalGClosure *target = marshal_data;
+  LuaGObjectState *state = target->state;
+  MarshalGClosureCall call;
+  lua_State *L = target->L, *pooled_L = NULL;
+  int top;
+  (void) closure;
+
+  /* Get access to proper Lua context, the thread which created the
+     closure.  When that thread is suspended, borrow a thread from the
+     callback thread pool, the same way as ffi closures do, and leave
+     the stack of the suspended thread alone. */
+  lua_gobject_state_enter (state->lock);
+  if (lua_status (L) != 0)
+    L = pooled_L = lua_gobject_callback_thread_acquire (target->L, state);
+  top = lua_gettop (L);
+
+  /* Invoke the target. */
+  call.target = target;
+  call.return_value = return_value;
+  call.n_param_values = n_param_values;
+  call.param_values = param_values;
+  lua_pushcfunction (L, marshal_gclosure_call);
+  lua_pushlightuserdata (L, &call);
+  lua_gobject_state_push (L, state, closure_refs);
+  lua_rawgeti (L, -1, target->target_ref);
+  lua_replace (L, -2);
+  if (lua_pcall (L, 2, 0, 0) != 0)
+    {
+      GSignalInvocationHint *hint = invocation_hint;
+      g_warning ("Error raised while calling '%s': %s",
+		 hint ? g_signal_name (hint->signal_id) : "closure",
+		 lua_tostring (L, -1));
+    }
+  lua_settop (L, top);
+  if (pooled_L != NULL)
+    lua_gobject_callback_thread_release (state, pooled_L);
+  lua_gobject_state_leave (state->lock);
+}
+
+static void
+marshal_gclosure_destroy (gpointer user_data, GClosure *closure)
+{
+  MarshalGClosure *target = user_data;
+  (void) closure;
+  lua_gobject_state_enter (target->state->lock);
+  lua_gobject_closure_unref (target->L, target->state, target->target_ref);
+  lua_gobject_closure_unref (target->L, target->state, target->thread_ref);
+  lua_gobject_state_leave (target->state->lock);
+  g_free (target);
+}
+
 /* Workaround for incorrectly annotated g_closure_invoke.  Since it is
    pretty performance-sensitive, it is implemented here in native code
    instead of creating overlay with custom ffi for it. */
@@ -1901,6 +3237,127 @@ marshal_closure_set_marshal (lua_State *L)
   return 0;
 }
 
+/* Sets native marshaller of the closure, invoking Lua target with
+   parameters marshalled according to the plan, which is an array of
+   fundamental types of parameters, with fundamental type of return
+   value in 'ret' field.  Lua prototype:
+   marshal.closure_set_target(closure, target, plan) */
+static int
+marshal_closure_set_target (lua_State *L)
+{
+  GClosure *closure;
+  MarshalGClosure *target;
+  guint n_params, i;
+
+  lua_gobject_type_get_repotype (L, G_TYPE_CLOSURE, NULL);
+  lua_gobject_record_2c (L, 1, &closure, FALSE, FALSE, FALSE, FALSE);
+  luaL_checkany (L, 2);
+  luaL_checktype (L, 3, LUA_TTABLE);
+
+  /* Compile the plan. */
+  n_params = lua_objlen (L, 3);
+  target = g_malloc (G_STRUCT_OFFSET (MarshalGClosure, params)
+		     + (n_params + 1) * sizeof (GType));
+  target->n_params = n_params;
+  for (i = 0; i < n_params; i++)
+    {
+      lua_rawgeti (L, 3, i + 1);
+      target->params[i] = lua_gobject_type_get_gtype (L, -1);
+      lua_pop (L, 1);
+    }
+  lua_getfield (L, 3, "ret");
+  target->ret = lua_isnil (L, -1)
+    ? G_TYPE_NONE : lua_gobject_type_get_gtype (L, -1);
+  lua_pop (L, 1);
+
+  /* Store the target and the current thread in the closure store. */
+  target->L = L;
+  target->state = lua_gobject_state_get (L);
+  lua_pushvalue (L, 2);
+  target->target_ref = lua_gobject_closure_ref (L, target->state);
+  lua_pushthread (L);
+  target->thread_ref = lua_gobject_closure_ref (L, target->state);
+
+  g_closure_set_meta_marshal (closure, target, marshal_gclosure_marshal);
+  g_closure_add_invalidate_notifier (closure, target,
+				     marshal_gclosure_destroy);
+  return 0;
+}
+
+/* Lua value providing data of GBytes created by marshal.bytes_wrap(),
+   kept referenced until the GBytes is freed. */
+typedef struct _BytesHold
+{
+  lua_State *L;
+  gpointer state_lock;
+  int data_ref;
+  int thread_ref;
+} BytesHold;
+
+static void
+bytes_hold_release (gpointer user_data)
+{
+  BytesHold *hold = user_data;
+  lua_gobject_state_enter (hold->state_lock);
+  luaL_unref (hold->L, LUA_REGISTRYINDEX, hold->data_ref);
+  luaL_unref (hold->L, LUA_REGISTRYINDEX, hold->thread_ref);
+  lua_gobject_state_leave (hold->state_lock);
+  g_free (hold);
+}
+
+/* Creates GLib.Bytes sharing memory of Lua string, bytes buffer or
+   buffer view, without copying it.  Lua prototype:
+   bytes = marshal.bytes_wrap(string|buffer) */
+static int
+marshal_bytes_wrap (lua_State *L)
+{
+  gconstpointer data;
+  gsize size;
+  size_t len;
+  BytesHold *hold;
+  GBytes *bytes;
+
+  data = lua_gobject_buffer_test (L, 1, &size);
+  if (data == NULL)
+    {
+      data = luaL_checklstring (L, 1, &len);
+      size = len;
+    }
+
+  /* Keep the data and the current thread referenced. */
+  hold = g_new (BytesHold, 1);
+  hold->L = L;
+  hold->state_lock = lua_gobject_state_get_lock (L);
+  lua_pushvalue (L, 1);
+  hold->data_ref = luaL_ref (L, LUA_REGISTRYINDEX);
+  lua_pushthread (L);
+  hold->thread_ref = luaL_ref (L, LUA_REGISTRYINDEX);
+
+  bytes = g_bytes_new_with_free_func (data, size, bytes_hold_release, hold);
+  lua_gobject_type_get_repotype (L, G_TYPE_BYTES, NULL);
+  lua_gobject_record_2lua (L, bytes, TRUE, 0);
+  return 1;
+}
+
+/* Creates read-only buffer view of GLib.Bytes data, which keeps the
+   bytes alive.  Lua prototype:
+   view = marshal.bytes_view(bytes) */
+static int
+marshal_bytes_view (lua_State *L)
+{
+  GBytes *bytes;
+  gconstpointer data;
+  gsize size;
+
+  lua_gobject_type_get_repotype (L, G_TYPE_BYTES, NULL);
+  lua_gobject_record_2c (L, 1, &bytes, FALSE, FALSE, FALSE, FALSE);
+  data = g_bytes_get_data (bytes, &size);
+  lua_gobject_buffer_view_new (L, (gpointer) data, size, FALSE,
+			       (GDestroyNotify) g_bytes_unref,
+			       g_bytes_ref (bytes));
+  return 1;
+}
+
 /* Calculates size and alignment of specified type.
    size, align = marshal.typeinfo(tiinfo) */
 static int
@@ -1950,6 +3407,9 @@ static const struct luaL_Reg marshal_api_reg[] = {
   { "argument", marshal_argument },
   { "callback", marshal_callback },
   { "closure_set_marshal", marshal_closure_set_marshal },
+  { "closure_set_target", marshal_closure_set_target },
+  { "bytes_wrap", marshal_bytes_wrap },
+  { "bytes_view", marshal_bytes_view },
   { "closure_invoke", marshal_closure_invoke },
   { "typeinfo", marshal_typeinfo },
   { NULL, NULL }
@@ -1958,6 +3418,16 @@ static const struct luaL_Reg marshal_api_reg[] = {
 void
 lua_gobject_marshal_init (lua_State *L)
 {
+  /* Register metatable of native containers. */
+  luaL_newmetatable (L, UD_LAZY_CONTAINER);
+  luaL_register (L, NULL, lazy_reg);
+  lua_pop (L, 1);
+
+  /* Create 'container' API table in main core API table. */
+  lua_newtable (L);
+  luaL_register (L, NULL, container_api_reg);
+  lua_setfield (L, -2, "container");
+
   /* Create 'marshal' API table in main core API table. */
   lua_newtable (L);
   luaL_register (L, NULL, marshal_api_reg);
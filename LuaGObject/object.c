@@ -11,12 +11,8 @@
 #include <string.h>
 #include "lua_gobject.h"
 
-/* lightuserdata key to registry, containing table representing weak
-   cache of known objects. */
-static int cache;
-
-/* lightuserdata key to registry for metatable of objects. */
-static int object_mt;
+/* Weak cache of known objects and metatable of objects are
+   referenced from per-state block, see LuaGObjectState. */
 
 /* lightuserdata key to registry, containing 'env' table, which maps
    lightuserdata(obj-addr) -> obj-env-table. */
@@ -51,14 +47,13 @@ typedef struct _ObjectEnvGuard
 /* Checks that given narg is object type and returns pointer to type
    instance representing it. */
 static gpointer
-object_check (lua_State *L, int narg)
+object_check (lua_State *L, LuaGObjectState *state, int narg)
 {
   gpointer *obj = lua_touserdata (L, narg);
   luaL_checkstack (L, 3, "");
   if (!lua_getmetatable (L, narg))
     return NULL;
-  lua_pushlightuserdata (L, &object_mt);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, state, object_mt);
   if (!lua_equal (L, -1, -2))
     obj = NULL;
 
@@ -118,9 +113,9 @@ object_type_error (lua_State *L, int narg, GType gtype)
 }
 
 static gpointer
-object_get (lua_State *L, int narg)
+object_get (lua_State *L, LuaGObjectState *state, int narg)
 {
-  gpointer obj = object_check (L, narg);
+  gpointer obj = object_check (L, state, narg);
   if (G_UNLIKELY (!obj))
     object_type_error (L, narg, G_TYPE_INVALID);
   return obj;
@@ -265,7 +260,7 @@ object_unref (lua_State *L, gpointer obj)
 static int
 object_gc (lua_State *L)
 {
-  object_unref (L, object_get (L, 1));
+  object_unref (L, object_get (L, lua_touserdata (L, lua_upvalueindex (1)), 1));
 
   /* Unset the metatable / make the object unusable */
   lua_pushnil (L);
@@ -276,7 +271,7 @@ object_gc (lua_State *L)
 static int
 object_tostring (lua_State *L)
 {
-  gpointer obj = object_get (L, 1);
+  gpointer obj = object_get (L, lua_touserdata (L, lua_upvalueindex (1)), 1);
   GType gtype = G_TYPE_FROM_INSTANCE (obj);
   lua_getfenv (L, 1);
   if (lua_isnil (L, -1))
@@ -308,7 +303,7 @@ lua_gobject_object_2c (lua_State *L, int narg, GType gtype, gboolean optional,
     return NULL;
 
   /* Get instance and perform type check. */
-  obj = object_check (L, narg);
+  obj = object_check (L, lua_gobject_state_get (L), narg);
   if (!nothrow
       && (!obj || (gtype != G_TYPE_INVALID
 		   && !g_type_is_a (G_TYPE_FROM_INSTANCE (obj), gtype))))
@@ -323,6 +318,8 @@ lua_gobject_object_2c (lua_State *L, int narg, GType gtype, gboolean optional,
 int
 lua_gobject_object_2lua (lua_State *L, gpointer obj, gboolean own, gboolean no_sink)
 {
+  LuaGObjectState *state;
+
   /* NULL pointer results in nil. */
   if (!obj)
     {
@@ -332,8 +329,8 @@ lua_gobject_object_2lua (lua_State *L, gpointer obj, gboolean own, gboolean no_s
 
   /* Check, whether the object is already created (in the cache). */
   luaL_checkstack (L, 6, "");
-  lua_pushlightuserdata (L, &cache);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  state = lua_gobject_state_get (L);
+  lua_gobject_state_push (L, state, object_cache);
   lua_pushlightuserdata (L, obj);
   lua_rawget (L, -2);
   if (!lua_isnil (L, -1))
@@ -351,8 +348,7 @@ lua_gobject_object_2lua (lua_State *L, gpointer obj, gboolean own, gboolean no_s
 
   /* Create new userdata object. */
   *(gpointer *) lua_newuserdata (L, sizeof (obj)) = obj;
-  lua_pushlightuserdata (L, &object_mt);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, state, object_mt);
   lua_setmetatable (L, -2);
   object_type (L, G_TYPE_FROM_INSTANCE (obj));
   lua_setfenv (L, -2);
@@ -375,20 +371,314 @@ lua_gobject_object_2lua (lua_State *L, gpointer obj, gboolean own, gboolean no_s
   return 1;
 }
 
+/* Indices of entries in object access cache, see object_access_cached(). */
+enum {
+  OBJECT_ACCESS_ELEMENT = 1,
+  OBJECT_ACCESS_OWNER,
+  OBJECT_ACCESS_HANDLER,
+  OBJECT_ACCESS_KEY
+};
+
+/* Finds the key under which the owner stores plain element resolved
+   for the symbol at index 2 and stores it into the entry.  Owner is
+   just below the top of the stack, element two slots below it.
+   Keyword-translated symbols are stored without their leading
+   underscore.  Returns FALSE if the owner does not hold the element
+   directly. */
+static gboolean
+object_access_key (lua_State *L, int entry)
+{
+  const char *symbol = lua_tostring (L, 2);
+  int owner = lua_gettop (L) - 1;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      if (i == 0)
+	lua_pushvalue (L, 2);
+      else if (symbol[0] == '_' && symbol[1] != '\0')
+	lua_pushstring (L, symbol + 1);
+      else
+	break;
+      lua_pushvalue (L, -1);
+      lua_rawget (L, owner);
+      if (lua_rawequal (L, -1, owner - 2))
+	{
+	  lua_pop (L, 1);
+	  lua_rawseti (L, entry, OBJECT_ACCESS_KEY);
+	  return TRUE;
+	}
+      lua_pop (L, 2);
+    }
+  return FALSE;
+}
+
+/* Tries to handle access to string symbol at index 2 of the object at
+   index 1, whose typetable is at index typetable, using inline cache
+   of resolved elements.  The cache maps typetable -> symbol -> entry,
+   where entry contains element, typetable which owns the element,
+   optional '_access<category>' handler and, for plain elements, the
+   key under which the owner stores the element (which differs from
+   the symbol for keyword-translated symbols like '_end').  Only
+   elements for which _element reports owning typetable are cached,
+   because those do not depend on the instance.  Returns FALSE if the
+   access has to go through typetable's _access method. */
+static gboolean
+object_access_cached (lua_State *L, LuaGObjectState *state, gboolean getmode,
+		      int typetable)
+{
+  int types, entry;
+
+  /* Lookup the entry for the typetable and symbol. */
+  luaL_checkstack (L, 8, "");
+  lua_gobject_state_push (L, state, object_access_cache);
+  lua_pushvalue (L, typetable);
+  lua_rawget (L, -2);
+  if (lua_isnil (L, -1))
+    {
+      lua_pop (L, 1);
+      lua_newtable (L);
+      lua_pushvalue (L, typetable);
+      lua_pushvalue (L, -2);
+      lua_rawset (L, -4);
+    }
+  types = lua_gettop (L);
+  lua_pushvalue (L, 2);
+  lua_rawget (L, types);
+  entry = lua_gettop (L);
+  if (!lua_isnil (L, entry))
+    {
+      /* Elements stored directly in the owning typetable are valid
+	 only as long as the typetable still holds them. */
+      lua_rawgeti (L, entry, OBJECT_ACCESS_HANDLER);
+      if (lua_isnil (L, -1))
+	{
+	  lua_rawgeti (L, entry, OBJECT_ACCESS_OWNER);
+	  lua_rawgeti (L, entry, OBJECT_ACCESS_KEY);
+	  lua_rawget (L, -2);
+	  lua_rawgeti (L, entry, OBJECT_ACCESS_ELEMENT);
+	  if (!lua_rawequal (L, -1, -2))
+	    {
+	      lua_pop (L, 4);
+	      lua_pushvalue (L, 2);
+	      lua_pushnil (L);
+	      lua_rawset (L, types);
+	      lua_pushnil (L);
+	      lua_replace (L, entry);
+	    }
+	  else
+	    lua_pop (L, 4);
+	}
+      else
+	lua_pop (L, 1);
+    }
+
+  if (lua_isnil (L, entry))
+    {
+      /* Cache miss, resolve the element using typetable's _element
+	 method, the same way as component's __index does. */
+      lua_pushliteral (L, "_element");
+      lua_rawget (L, typetable);
+      if (lua_isnil (L, -1))
+	{
+	  lua_pop (L, 1);
+	  if (!lua_getmetatable (L, typetable))
+	    {
+	      lua_pop (L, 3);
+	      return FALSE;
+	    }
+	  lua_pushliteral (L, "_element");
+	  lua_rawget (L, -2);
+	  lua_replace (L, -2);
+	}
+      lua_pushvalue (L, typetable);
+      lua_pushvalue (L, 1);
+      lua_pushvalue (L, 2);
+      lua_call (L, 3, 3);
+      if (lua_isnil (L, -3) || !lua_istable (L, -1))
+	{
+	  /* Not found or not cacheable, let _access handle it. */
+	  lua_pop (L, 6);
+	  return FALSE;
+	}
+
+      /* Create the entry, find out the handler for the category. */
+      lua_createtable (L, 4, 0);
+      lua_replace (L, entry);
+      if (lua_type (L, -2) == LUA_TSTRING)
+	{
+	  lua_pushfstring (L, "_access%s", lua_tostring (L, -2));
+	  lua_gettable (L, typetable);
+	  lua_rawseti (L, entry, OBJECT_ACCESS_HANDLER);
+	}
+      lua_rawgeti (L, entry, OBJECT_ACCESS_HANDLER);
+      if (lua_isnil (L, -1) && !object_access_key (L, entry))
+	{
+	  /* Plain element which cannot be revalidated. */
+	  lua_pop (L, 7);
+	  return FALSE;
+	}
+      lua_pop (L, 1);
+      lua_rawseti (L, entry, OBJECT_ACCESS_OWNER);
+      lua_pop (L, 1);
+      lua_rawseti (L, entry, OBJECT_ACCESS_ELEMENT);
+      lua_pushvalue (L, 2);
+      lua_pushvalue (L, entry);
+      lua_rawset (L, types);
+    }
+
+  /* Dispatch according to the entry. */
+  lua_rawgeti (L, entry, OBJECT_ACCESS_HANDLER);
+  if (lua_isnil (L, -1))
+    {
+      /* Writing into plain element is an error, reported by
+	 _access. */
+      if (!getmode)
+	{
+	  lua_pop (L, 4);
+	  return FALSE;
+	}
+
+      lua_rawgeti (L, entry, OBJECT_ACCESS_ELEMENT);
+      return TRUE;
+    }
+
+  lua_pushvalue (L, typetable);
+  lua_pushvalue (L, 1);
+  lua_rawgeti (L, entry, OBJECT_ACCESS_ELEMENT);
+  if (getmode)
+    {
+      lua_call (L, 3, 1);
+      return TRUE;
+    }
+  lua_pushvalue (L, 3);
+  lua_call (L, 4, 0);
+  return TRUE;
+}
+
 /* Worker method for __index and __newindex implementation. */
 static int
 object_access (lua_State *L)
 {
+  LuaGObjectState *state = lua_touserdata (L, lua_upvalueindex (1));
   gboolean getmode = lua_isnone (L, 3);
+  int typetable;
 
   /* Check that 1st arg is an object and invoke one of the forms:
      result = type:_access(objectinstance, name)
      type:_access(objectinstance, name, val) */
-  object_get (L, 1);
+  object_get (L, state, 1);
   lua_getfenv (L, 1);
+  typetable = lua_gettop (L);
+  if (lua_type (L, 2) == LUA_TSTRING
+      && object_access_cached (L, state, getmode, typetable))
+    return getmode ? 1 : 0;
+
   return lua_gobject_marshal_access (L, getmode, 1, 2, 3);
 }
 
+/* Checks whether typetable at index type is the typetable at index
+   base, or inherits or implements it. */
+static gboolean
+object_type_is_a (lua_State *L, int type, int base)
+{
+  gboolean found = FALSE;
+  lua_pushvalue (L, type);
+  while (!found && lua_istable (L, -1))
+    {
+      found = lua_rawequal (L, -1, base);
+      lua_pushliteral (L, "_implements");
+      lua_rawget (L, -2);
+      if (!found && lua_istable (L, -1))
+	{
+	  lua_pushnil (L);
+	  while (lua_next (L, -2))
+	    {
+	      found = lua_rawequal (L, -1, base);
+	      lua_pop (L, 1);
+	      if (found)
+		{
+		  lua_pop (L, 1);
+		  break;
+		}
+	    }
+	}
+      lua_pop (L, 1);
+      lua_pushliteral (L, "_parent");
+      lua_rawget (L, -2);
+      lua_replace (L, -2);
+    }
+  lua_pop (L, 1);
+  return found;
+}
+
+/* Invalidates object access cache, called whenever typetable is
+   modified.  Only elements cached for the typetable and for types
+   inheriting or implementing it are dropped, because only those can
+   be shadowed by the new member or be owned by the typetable.  When
+   the modified key is a plain name, only the symbols which can
+   resolve to it (the name itself and its keyword-translated form
+   with leading underscore) are dropped, so that filling typetables
+   with overrides stays cheap.  Without typetable, the whole cache is
+   invalidated.  Lua prototype:
+   object.invalidate([typetable [, key]]) */
+static int
+object_invalidate (lua_State *L)
+{
+  LuaGObjectState *state = lua_gobject_state_get (L);
+  const char *key = NULL;
+  int cache;
+  lua_gobject_state_push (L, state, object_access_cache);
+  cache = lua_gettop (L);
+  if (lua_isnoneornil (L, 1))
+    {
+      lua_pushnil (L);
+      if (lua_next (L, cache))
+	{
+	  lua_gobject_cache_create (L, "k");
+	  lua_rawseti (L, LUA_REGISTRYINDEX, state->object_access_cache);
+	}
+      return 0;
+    }
+
+  luaL_checktype (L, 1, LUA_TTABLE);
+  if (lua_type (L, 2) == LUA_TSTRING)
+    {
+      key = lua_tostring (L, 2);
+      if (key[0] == '_')
+	/* Underscored keys can be categories or '_access' handlers,
+	   which affect all symbols. */
+	key = NULL;
+      else
+	lua_pushfstring (L, "_%s", key);
+    }
+
+  lua_pushnil (L);
+  while (lua_next (L, cache))
+    {
+      if (object_type_is_a (L, lua_gettop (L) - 1, 1))
+	{
+	  if (key != NULL)
+	    {
+	      lua_pushvalue (L, 2);
+	      lua_pushnil (L);
+	      lua_rawset (L, -3);
+	      lua_pushvalue (L, cache + 1);
+	      lua_pushnil (L);
+	      lua_rawset (L, -3);
+	    }
+	  else
+	    {
+	      lua_pushvalue (L, -2);
+	      lua_pushnil (L);
+	      lua_rawset (L, cache);
+	    }
+	}
+      lua_pop (L, 1);
+    }
+  return 0;
+}
+
 /* Registration table. */
 static const luaL_Reg object_mt_reg[] = {
   { "__gc", object_gc },
@@ -408,7 +698,7 @@ static const char *const query_mode[] = { "addr", "repo", NULL };
 static int
 object_query (lua_State *L)
 {
-  gpointer object = object_check (L, 1);
+  gpointer object = object_check (L, lua_gobject_state_get (L), 1);
   if (object)
     {
       int mode = luaL_checkoption (L, 2, query_mode[0], query_mode);
@@ -431,7 +721,7 @@ object_field (lua_State *L)
   gboolean getmode = lua_isnone (L, 3);
 
   /* Get object instance. */
-  gpointer object = object_get (L, 1);
+  gpointer object = object_get (L, lua_gobject_state_get (L), 1);
 
   /* Call field marshalling worker. */
   lua_getfenv (L, 1);
@@ -479,7 +769,7 @@ static int
 object_env (lua_State *L)
 {
   ObjectData *data;
-  gpointer obj = object_get (L, 1);
+  gpointer obj = object_get (L, lua_gobject_state_get (L), 1);
   if (!G_IS_OBJECT (obj))
     /* Only GObject instances can have environment. */
     return 0;
@@ -581,28 +871,506 @@ object_new (lua_State *L)
     }
 }
 
+/* Descriptor of GI-described property, used by native property
+   accessor. */
+typedef struct _ObjectProperty
+{
+  /* Interned name of the property. */
+  const gchar *name;
+
+  /* GType of GValue used for the transfer, G_TYPE_INVALID if the
+     property cannot be handled natively. */
+  GType gtype;
+
+  /* Type tag used for marshalling integral values. */
+  GITypeTag tag;
+
+  /* Access flags of the property. */
+  guint readable : 1;
+  guint writable : 1;
+} ObjectProperty;
+
+/* Sets GType of GValue used for the transfer of the property, or
+   G_TYPE_INVALID if the type cannot be marshalled natively. */
+static void
+object_property_set_gtype (ObjectProperty *property, GType gtype)
+{
+  /* Integral values are marshalled by the tag of their GValue
+     accessor, the same way as GObject.Value does. */
+  property->tag = GI_TYPE_TAG_VOID;
+  switch (G_TYPE_FUNDAMENTAL (gtype))
+    {
+    case G_TYPE_CHAR: property->tag = GI_TYPE_TAG_INT8; break;
+    case G_TYPE_UCHAR: property->tag = GI_TYPE_TAG_UINT8; break;
+    case G_TYPE_INT: property->tag = GI_TYPE_TAG_INT32; break;
+    case G_TYPE_UINT: property->tag = GI_TYPE_TAG_UINT32; break;
+    case G_TYPE_INT64: property->tag = GI_TYPE_TAG_INT64; break;
+    case G_TYPE_UINT64: property->tag = GI_TYPE_TAG_UINT64; break;
+
+    case G_TYPE_BOOLEAN:
+    case G_TYPE_FLOAT:
+    case G_TYPE_DOUBLE:
+    case G_TYPE_STRING:
+    case G_TYPE_ENUM:
+      break;
+
+    case G_TYPE_OBJECT:
+    case G_TYPE_INTERFACE:
+      if (g_type_is_a (gtype, G_TYPE_OBJECT))
+	break;
+      /* Fall through. */
+
+    default:
+      gtype = G_TYPE_INVALID;
+      break;
+    }
+  property->gtype = gtype;
+}
+
+/* Fills property descriptor for given property info. */
+static void
+object_property_init (ObjectProperty *property, GIPropertyInfo *pi)
+{
+  GITypeInfo *ti = gi_property_info_get_type_info (pi);
+  GParamFlags flags = gi_property_info_get_flags (pi);
+  GType gtype = G_TYPE_INVALID;
+
+  switch (gi_type_info_get_tag (ti))
+    {
+#define H(tag, type)				\
+    case GI_TYPE_TAG_ ## tag:			\
+      gtype = G_TYPE_ ## type;			\
+      break;
+
+      H(BOOLEAN, BOOLEAN)
+      H(INT8, CHAR)
+      H(UINT8, UCHAR)
+      H(INT16, INT)
+      H(UINT16, UINT)
+      H(INT32, INT)
+      H(UINT32, UINT)
+      H(UNICHAR, UINT)
+      H(INT64, INT64)
+      H(UINT64, UINT64)
+      H(FLOAT, FLOAT)
+      H(DOUBLE, DOUBLE)
+      H(UTF8, STRING)
+      H(FILENAME, STRING)
+#undef H
+
+    case GI_TYPE_TAG_INTERFACE:
+      {
+	GIBaseInfo *info = gi_type_info_get_interface (ti);
+	if (GI_IS_OBJECT_INFO (info) || GI_IS_INTERFACE_INFO (info)
+	    || (GI_IS_ENUM_INFO (info) && !GI_IS_FLAGS_INFO (info)))
+	  gtype = gi_registered_type_info_get_g_type (GI_REGISTERED_TYPE_INFO (info));
+	gi_base_info_unref (info);
+	break;
+      }
+
+    default:
+      break;
+    }
+  gi_base_info_unref (ti);
+
+  object_property_set_gtype (property, gtype);
+  property->name = g_intern_string (gi_base_info_get_name (GI_BASE_INFO (pi)));
+  property->readable = (flags & G_PARAM_READABLE) != 0;
+  property->writable = (flags & G_PARAM_WRITABLE) != 0;
+}
+
+/* Converts Lua value at narg into initialized GValue of the property. */
+static void
+object_property_2c (lua_State *L, ObjectProperty *property, int narg,
+		    GValue *value)
+{
+  GIArgument arg;
+  switch (G_TYPE_FUNDAMENTAL (property->gtype))
+    {
+    case G_TYPE_BOOLEAN:
+      g_value_set_boolean (value, lua_toboolean (L, narg));
+      break;
+
+    case G_TYPE_CHAR:
+      lua_gobject_marshal_2c_int (L, property->tag, &arg, narg, FALSE, 0);
+      g_value_set_schar (value, arg.v_int8);
+      break;
+
+    case G_TYPE_UCHAR:
+      lua_gobject_marshal_2c_int (L, property->tag, &arg, narg, FALSE, 0);
+      g_value_set_uchar (value, arg.v_uint8);
+      break;
+
+    case G_TYPE_INT:
+      lua_gobject_marshal_2c_int (L, property->tag, &arg, narg, FALSE, 0);
+      g_value_set_int (value, arg.v_int32);
+      break;
+
+    case G_TYPE_UINT:
+      lua_gobject_marshal_2c_int (L, property->tag, &arg, narg, FALSE, 0);
+      g_value_set_uint (value, arg.v_uint32);
+      break;
+
+    case G_TYPE_INT64:
+      lua_gobject_marshal_2c_int (L, property->tag, &arg, narg, FALSE, 0);
+      g_value_set_int64 (value, arg.v_int64);
+      break;
+
+    case G_TYPE_UINT64:
+      lua_gobject_marshal_2c_int (L, property->tag, &arg, narg, FALSE, 0);
+      g_value_set_uint64 (value, arg.v_uint64);
+      break;
+
+    case G_TYPE_FLOAT:
+      g_value_set_float (value, luaL_checknumber (L, narg));
+      break;
+
+    case G_TYPE_DOUBLE:
+      g_value_set_double (value, luaL_checknumber (L, narg));
+      break;
+
+    case G_TYPE_STRING:
+      g_value_set_string (value, lua_isnoneornil (L, narg)
+			  ? NULL : luaL_checkstring (L, narg));
+      break;
+
+    case G_TYPE_ENUM:
+      /* Convert symbolic value to number using enum 'constructor'. */
+      if (lua_type (L, narg) != LUA_TNUMBER)
+	{
+	  lua_gobject_type_get_repotype (L, property->gtype, NULL);
+	  lua_pushvalue (L, narg);
+	  lua_call (L, 1, 1);
+	  g_value_set_enum (value, luaL_checkinteger (L, -1));
+	  lua_pop (L, 1);
+	}
+      else
+	g_value_set_enum (value, lua_tointeger (L, narg));
+      break;
+
+    default:
+      g_value_set_object (value, lua_gobject_object_2c (L, narg, property->gtype,
+						       TRUE, FALSE, FALSE));
+      break;
+    }
+}
+
+/* Pushes contents of the GValue of the property to the stack. */
+static void
+object_property_2lua (lua_State *L, ObjectProperty *property, GValue *value)
+{
+  GIArgument arg;
+  switch (G_TYPE_FUNDAMENTAL (property->gtype))
+    {
+    case G_TYPE_BOOLEAN:
+      lua_pushboolean (L, g_value_get_boolean (value));
+      break;
+
+    case G_TYPE_CHAR:
+      arg.v_int8 = g_value_get_schar (value);
+      lua_gobject_marshal_2lua_int (L, property->tag, &arg, 0);
+      break;
+
+    case G_TYPE_UCHAR:
+      arg.v_uint8 = g_value_get_uchar (value);
+      lua_gobject_marshal_2lua_int (L, property->tag, &arg, 0);
+      break;
+
+    case G_TYPE_INT:
+      arg.v_int32 = g_value_get_int (value);
+      lua_gobject_marshal_2lua_int (L, property->tag, &arg, 0);
+      break;
+
+    case G_TYPE_UINT:
+      arg.v_uint32 = g_value_get_uint (value);
+      lua_gobject_marshal_2lua_int (L, property->tag, &arg, 0);
+      break;
+
+    case G_TYPE_INT64:
+      arg.v_int64 = g_value_get_int64 (value);
+      lua_gobject_marshal_2lua_int (L, property->tag, &arg, 0);
+      break;
+
+    case G_TYPE_UINT64:
+      arg.v_uint64 = g_value_get_uint64 (value);
+      lua_gobject_marshal_2lua_int (L, property->tag, &arg, 0);
+      break;
+
+    case G_TYPE_FLOAT:
+      lua_pushnumber (L, g_value_get_float (value));
+      break;
+
+    case G_TYPE_DOUBLE:
+      lua_pushnumber (L, g_value_get_double (value));
+      break;
+
+    case G_TYPE_STRING:
+      lua_pushstring (L, g_value_get_string (value));
+      break;
+
+    case G_TYPE_ENUM:
+      /* Get symbolic value from the repotable of the enum. */
+      lua_gobject_type_get_repotype (L, property->gtype, NULL);
+      lua_pushinteger (L, g_value_get_enum (value));
+      lua_gettable (L, -2);
+      lua_remove (L, -2);
+      break;
+
+    default:
+      lua_gobject_object_2lua (L, g_value_get_object (value), FALSE, FALSE);
+      break;
+    }
+}
+
+/* Native implementation of _access_property handler.  Lua-side
+   prototypes:
+   res = accessor(typetable, objectinstance, property)
+   accessor(typetable, objectinstance, property, newvalue)
+   Upvalue 1 is generic Lua accessor, used for properties which cannot
+   be handled natively, upvalue 2 is weak table caching ObjectProperty
+   descriptors by property element. */
+static int
+object_access_property (lua_State *L)
+{
+  gboolean getmode = lua_isnone (L, 4);
+  ObjectProperty *property;
+  GValue value = G_VALUE_INIT;
+  gpointer object;
+
+  /* Find the descriptor of the property, create it if needed. */
+  lua_pushvalue (L, 3);
+  lua_rawget (L, lua_upvalueindex (2));
+  property = lua_touserdata (L, -1);
+  lua_pop (L, 1);
+  if (G_UNLIKELY (property == NULL))
+    {
+      GIBaseInfo **info = lua_gobject_udata_test (L, 3, LUA_GOBJECT_GI_INFO);
+      lua_pushvalue (L, 3);
+      property = lua_newuserdata (L, sizeof (*property));
+      if (info && GI_IS_PROPERTY_INFO (*info))
+	object_property_init (property, GI_PROPERTY_INFO (*info));
+      else
+	property->gtype = G_TYPE_INVALID;
+      lua_rawset (L, lua_upvalueindex (2));
+    }
+
+  if (property->gtype == G_TYPE_INVALID)
+    {
+      /* Let generic accessor handle this property. */
+      lua_pushvalue (L, lua_upvalueindex (1));
+      lua_insert (L, 1);
+      lua_call (L, lua_gettop (L) - 1, LUA_MULTRET);
+      return lua_gettop (L);
+    }
+
+  /* Check access rights of the property. */
+  if (getmode ? !property->readable : !property->writable)
+    {
+      lua_getfenv (L, 2);
+      lua_getfield (L, -1, "_name");
+      return luaL_error (L, "%s: `%s' not %s", lua_tostring (L, -1),
+			 property->name, getmode ? "readable" : "writable");
+    }
+
+  object = lua_gobject_object_2c (L, 2, G_TYPE_OBJECT, FALSE, FALSE, FALSE);
+  g_value_init (&value, property->gtype);
+  if (getmode)
+    {
+      g_object_get_property (object, property->name, &value);
+      object_property_2lua (L, property, &value);
+      g_value_unset (&value);
+      return 1;
+    }
+
+  object_property_2c (L, property, 4, &value);
+  g_object_set_property (object, property->name, &value);
+  g_value_unset (&value);
+  return 0;
+}
+
+/* Creates native property accessor, suitable as _access_property
+   handler.  Lua prototype:
+   accessor = object.property(generic_accessor) */
+static int
+object_property (lua_State *L)
+{
+  luaL_checktype (L, 1, LUA_TFUNCTION);
+  lua_settop (L, 1);
+  lua_gobject_cache_create (L, "k");
+  lua_pushcclosure (L, object_access_property, 2);
+  return 1;
+}
+
+/* Set of GValues transferred by a single batch property call. */
+typedef struct _ObjectPropertyBatch
+{
+  guint n_values;
+  const gchar **names;
+  GValue *values;
+} ObjectPropertyBatch;
+
+static ObjectPropertyBatch *
+object_property_batch_new (guint size)
+{
+  ObjectPropertyBatch *batch = g_new (ObjectPropertyBatch, 1);
+  batch->n_values = 0;
+  batch->names = g_new (const gchar *, size);
+  batch->values = g_new0 (GValue, size);
+  return batch;
+}
+
+static void
+object_property_batch_free (gpointer data)
+{
+  ObjectPropertyBatch *batch = data;
+  guint i;
+  for (i = 0; i < batch->n_values; i++)
+    g_value_unset (&batch->values[i]);
+  g_free (batch->names);
+  g_free (batch->values);
+  g_free (batch);
+}
+
+/* Finds pspec of the property of the object, whose name is at narg
+   of the stack.  Throws an error if it does not exist or does not
+   permit requested access. */
+static GParamSpec *
+object_property_find (lua_State *L, GObject *object, int narg,
+		      GParamFlags access)
+{
+  GParamSpec *pspec = NULL;
+  const gchar *name = NULL;
+  if (lua_type (L, narg) == LUA_TSTRING)
+    {
+      gchar *canonical;
+      name = lua_tostring (L, narg);
+      canonical = g_strdelimit (g_strdup (name), "_", '-');
+      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (object),
+					    canonical);
+      g_free (canonical);
+    }
+  if (pspec == NULL)
+    luaL_error (L, "%s: no property `%s'", G_OBJECT_TYPE_NAME (object),
+		name ? name : luaL_typename (L, narg));
+  if ((pspec->flags & access) == 0
+      || (access == G_PARAM_WRITABLE
+	  && (pspec->flags & G_PARAM_CONSTRUCT_ONLY) != 0))
+    luaL_error (L, "%s: `%s' not %s", G_OBJECT_TYPE_NAME (object), name,
+		access == G_PARAM_WRITABLE ? "writable" : "readable");
+  return pspec;
+}
+
+/* Sets multiple properties at once, with change notifications
+   coalesced.  Lua prototype:
+   object.set_properties(objectinstance, { name = value, ... }) */
+static int
+object_set_properties (lua_State *L)
+{
+  GObject *object = lua_gobject_object_2c (L, 1, G_TYPE_OBJECT,
+					   FALSE, FALSE, FALSE);
+  ObjectPropertyBatch *batch;
+  guint size = 0;
+  luaL_checktype (L, 2, LUA_TTABLE);
+  lua_settop (L, 2);
+
+  /* Count the properties and allocate the batch, guarded so that it
+     does not leak when marshalling fails. */
+  lua_pushnil (L);
+  while (lua_next (L, 2))
+    {
+      size++;
+      lua_pop (L, 1);
+    }
+  batch = object_property_batch_new (size);
+  *lua_gobject_guard_create (L, object_property_batch_free) = batch;
+
+  /* Marshal all values. */
+  lua_pushnil (L);
+  while (lua_next (L, 2))
+    {
+      GParamSpec *pspec = object_property_find (L, object, -2,
+						G_PARAM_WRITABLE);
+      GValue *value = &batch->values[batch->n_values];
+      batch->names[batch->n_values++] = pspec->name;
+      g_value_init (value, pspec->value_type);
+      lua_gobject_marshal_value_2c (L, -1, value, G_TYPE_INVALID);
+      lua_pop (L, 1);
+    }
+
+  /* Set all of them in one go. */
+  g_object_freeze_notify (object);
+  g_object_setv (object, batch->n_values, batch->names, batch->values);
+  g_object_thaw_notify (object);
+  return 0;
+}
+
+/* Gets multiple properties at once.  Lua prototype:
+   value1, value2, ... = object.get_properties(objectinstance,
+						{ name1, name2, ... }) */
+static int
+object_get_properties (lua_State *L)
+{
+  GObject *object = lua_gobject_object_2c (L, 1, G_TYPE_OBJECT,
+					   FALSE, FALSE, FALSE);
+  ObjectPropertyBatch *batch;
+  guint size, i;
+  luaL_checktype (L, 2, LUA_TTABLE);
+  lua_settop (L, 2);
+  size = lua_objlen (L, 2);
+  luaL_checkstack (L, size + 4, "");
+  batch = object_property_batch_new (size);
+  *lua_gobject_guard_create (L, object_property_batch_free) = batch;
+
+  /* Prepare values of requested types. */
+  for (i = 0; i < size; i++)
+    {
+      GParamSpec *pspec;
+      lua_rawgeti (L, 2, i + 1);
+      pspec = object_property_find (L, object, -1, G_PARAM_READABLE);
+      batch->names[i] = pspec->name;
+      g_value_init (&batch->values[i], pspec->value_type);
+      batch->n_values++;
+      lua_pop (L, 1);
+    }
+
+  /* Retrieve and marshal all values. */
+  g_object_getv (object, batch->n_values, batch->names, batch->values);
+  for (i = 0; i < size; i++)
+    lua_gobject_marshal_value_2lua (L, &batch->values[i], G_TYPE_INVALID);
+  return size;
+}
+
 /* Object API table. */
 static const luaL_Reg object_api_reg[] = {
   { "query", object_query },
   { "field", object_field },
   { "new", object_new },
   { "env", object_env },
+  { "invalidate", object_invalidate },
+  { "property", object_property },
+  { "set_properties", object_set_properties },
+  { "get_properties", object_get_properties },
   { NULL, NULL }
 };
 
 void
 lua_gobject_object_init (lua_State *L)
 {
+  LuaGObjectState *state = lua_gobject_state_get (L);
   char *id;
 
   /* Register metatable. */
-  lua_pushlightuserdata (L, &object_mt);
   lua_newtable (L);
-  luaL_register (L, NULL, object_mt_reg);
-  lua_rawset (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_register (L, state, object_mt_reg);
+  state->object_mt = luaL_ref (L, LUA_REGISTRYINDEX);
 
   /* Initialize object cache. */
-  lua_gobject_cache_create (L, &cache, "v");
+  lua_gobject_cache_create (L, "v");
+  state->object_cache = luaL_ref (L, LUA_REGISTRYINDEX);
+
+  /* Initialize cache of resolved elements used by object access. */
+  lua_gobject_cache_create (L, "k");
+  state->object_access_cache = luaL_ref (L, LUA_REGISTRYINDEX);
 
   /* Create table for 'env' tables. */
   lua_pushlightuserdata (L, &env);
@@ -12,6 +12,7 @@ local select, type, pairs, tostring, setmetatable, error, assert
    = select, type, pairs, tostring, setmetatable, error, assert
 
 local LuaGObject = require 'LuaGObject'
+local core = require 'LuaGObject.core'
 local GLib = LuaGObject.GLib
 local Bytes = GLib.Bytes
 
@@ -20,3 +21,11 @@ Bytes._len = Bytes.get_size
 
 -- Add support for querying bytes attribute
 Bytes._attribute = { data = { get = Bytes.get_data } }
+
+-- Zero-copy construction from Lua string or bytes buffer, which is
+-- kept alive as long as the Bytes instance is.
+Bytes.wrap = core.marshal.bytes_wrap
+
+-- Read-only buffer view of the data, which does not copy them into
+-- Lua string.
+Bytes._attribute.view = { get = core.marshal.bytes_view }
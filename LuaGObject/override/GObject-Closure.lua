@@ -26,6 +26,34 @@ local closure_info = gi.GObject.Closure
 local CallInfo = {}
 CallInfo.__index = CallInfo
 
+-- Fundamental types of values, which are marshalled to Lua by copy
+-- or by reference, so that the GValue can be reset and reused once
+-- the call finishes.
+local reusable_types = {}
+for _, name in pairs { 'BOOLEAN', 'CHAR', 'UCHAR', 'INT', 'UINT', 'LONG',
+		       'ULONG', 'INT64', 'UINT64', 'FLOAT', 'DOUBLE',
+		       'STRING', 'ENUM', 'FLAGS', 'OBJECT', 'INTERFACE' } do
+   reusable_types[Type[name]] = true
+end
+local function is_reusable(cell)
+   return (cell.gtype and not cell.len_index and not cell.internal
+	   and reusable_types[Type.fundamental(cell.gtype)])
+end
+
+-- Checks whether input value can be marshalled to Lua natively.
+-- Boxed records are wrapped natively too, unless they are containers
+-- which are marshalled to Lua tables.
+local container_types = {
+   [Type.STRV] = true, [Type.ARRAY] = true, [Type.BYTE_ARRAY] = true,
+   [Type.PTR_ARRAY] = true, [Type.HASH_TABLE] = true,
+}
+local function is_native(cell)
+   return cell.dir == 'in' and (is_reusable(cell) or (
+	     cell.gtype and not cell.len_index and not cell.internal
+		and not container_types[cell.gtype]
+		and Type.fundamental(cell.gtype) == Type.BOXED))
+end
+
 -- Compile callable_info into table which allows fast marshalling
 function CallInfo.new(callable_info, to_lua)
    local self = setmetatable(
@@ -128,9 +156,58 @@ function CallInfo.new(callable_info, to_lua)
 	 self.ret = ret
       end
    end
+
+   -- When all values can be reset after the call, keep pool of
+   -- already allocated GValue arrays, so that repeated calls do not
+   -- have to create them again.
+   if not to_lua and not self.phantom
+      and (not self.ret or is_reusable(self.ret)) then
+      local reusable = true
+      for i = 1, #self do
+	 reusable = reusable and self[i].dir == 'in' and is_reusable(self[i])
+      end
+      if reusable then self.pool = {} end
+   end
+
+   -- When all arguments are plain input values of types which can be
+   -- marshalled natively, compile plan for native closure marshaller,
+   -- containing fundamental types of all parameters.
+   if to_lua and not self.phantom
+      and (not self.ret or is_reusable(self.ret)) then
+      local native = {
+	 ret = self.ret and Type.fundamental(self.ret.gtype) or nil }
+      for i = 1, #self do
+	 if not is_native(self[i]) then
+	    native = nil
+	    break
+	 end
+	 native[i] = Type.fundamental(self[i].gtype)
+      end
+      self.native = native
+   end
    return self
 end
 
+-- Cache of compiled CallInfo instances, keyed by callable info.  The
+-- compiled instance depends only on the info, so it can be shared by
+-- all closures and emissions of the same callable.
+local call_info_cache = {
+   [true] = setmetatable({}, { __mode = 'k' }),
+   [false] = setmetatable({}, { __mode = 'k' }),
+}
+
+-- Gets compiled CallInfo for callable_info, compiling it only on the
+-- first request.
+function CallInfo.get(callable_info, to_lua)
+   local cache = call_info_cache[to_lua and true or false]
+   local call_info = cache[callable_info]
+   if not call_info then
+      call_info = CallInfo.new(callable_info, to_lua)
+      cache[callable_info] = call_info
+   end
+   return call_info
+end
+
 -- Marshal single call_info cell (either input or output).
 local function marshal_cell(
       call_info, cell, direction, args, argc,
@@ -217,9 +294,20 @@ end
 -- params) and keepalive value (which must be kept alive during the
 -- call)
 function CallInfo:pre_call(...)
-   -- Prepare array of param values and initialize them with correct type.
-   local params = {}
-   for i = 1, #self do params[#params + 1] = Value(self[i].gtype) end
+   -- Prepare array of param values and initialize them with correct
+   -- type, or take already prepared ones from the pool.
+   local pool, retval, params = self.pool
+   local pooled = pool and #pool or 0
+   if pooled > 0 then
+      retval, params = pool[pooled - 1], pool[pooled]
+      pool[pooled - 1], pool[pooled] = nil, nil
+   else
+      params = {}
+      for i = 1, #self do params[#params + 1] = Value(self[i].gtype) end
+      retval = Value()
+      if self.ret then retval.type = self.ret.gtype end
+      if self.phantom then retval.type = self.phantom.gtype end
+   end
    local marshalling_params = { keepalive = {} }
 
    -- Marshal input values.
@@ -229,11 +317,6 @@ function CallInfo:pre_call(...)
 	 self, self[i], 'to_value', args, argc,
 	 marshalling_params, params[i], params)
    end
-
-   -- Prepare return value.
-   local retval = Value()
-   if self.ret then retval.type = self.ret.gtype end
-   if self.phantom then retval.type = self.phantom.gtype end
    return retval, params, marshalling_params
 end
 
@@ -267,6 +350,20 @@ function CallInfo:post_call(params, retval, marshalling_params)
    return unpack(args, 1, argc)
 end
 
+-- Returns Values created by pre_call back to the pool, if the
+-- CallInfo keeps one.  Values are reset, so that they do not keep
+-- anything alive.  Returns all remaining arguments.
+function CallInfo:release(retval, params, ...)
+   local pool = self.pool
+   if pool then
+      for i = 1, #params do Value.reset(params[i]) end
+      if self.ret then Value.reset(retval) end
+      pool[#pool + 1] = retval
+      pool[#pool + 1] = params
+   end
+   return ...
+end
+
 -- Create new closure invoking Lua target function (or anything else
 -- that can be called).  Optionally callback_info specifies detailed
 -- information about how to marshal signals.
@@ -275,9 +372,14 @@ function Closure:_new(target, callback_info)
    if target then
       local marshaller
       if callback_info then
-	 -- Create marshaller based on callinfo.
-	 local call_info = CallInfo.new(callback_info, true)
-	 marshaller = call_info:get_closure_marshaller(target)
+	 -- Create marshaller based on callinfo, use native one if
+	 -- the signature allows it.
+	 local call_info = CallInfo.get(callback_info, true)
+	 if call_info.native and type(target) ~= 'thread' then
+	    core.marshal.closure_set_target(closure, target, call_info.native)
+	 else
+	    marshaller = call_info:get_closure_marshaller(target)
+	 end
       else
 	 -- Create marshaller based only on Value types.
 	 function marshaller(closure, retval, params)
@@ -287,7 +389,9 @@ function Closure:_new(target, callback_info)
 	    if retval then retval.value = ret end
 	 end
       end
-      core.marshal.closure_set_marshal(closure, marshaller)
+      if marshaller then
+	 core.marshal.closure_set_marshal(closure, marshaller)
+      end
    end
    Closure.ref(closure)
    Closure.sink(closure)
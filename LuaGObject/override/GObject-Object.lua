@@ -230,8 +230,8 @@ end
 -- interfaces and dynamic properties.
 local inherited_element = Object._element
 function Object:_element(object, name)
-   local element, category = inherited_element(self, object, name)
-   if element then return element, category end
+   local element, category, owner = inherited_element(self, object, name)
+   if element then return element, category, owner end
 
    -- Everything else works only if we have object instance.
    if not object then return nil end
@@ -271,8 +271,8 @@ local function marshal_property(obj, name, flags, gtype, marshaller, ...)
    end
 end
 
--- Property accessor.
-function Object:_access_property(object, prop, ...)
+-- Generic property accessor.
+local function access_property(self, object, prop, ...)
    if gi.isinfo(prop) then
       -- GI-based property
       local typeinfo = prop.typeinfo
@@ -288,32 +288,102 @@ function Object:_access_property(object, prop, ...)
    end
 end
 
+-- Property accessor.  Properties of scalar, string, enum and object types
+-- are marshalled natively by the core, the rest goes through the
+-- generic accessor.
+Object._access_property = core.object.property(access_property)
+
+-- Batch property access, marshalling all values in single call and
+-- emitting coalesced notifications when setting.
+Object.set_properties = core.object.set_properties
+Object.get_properties = core.object.get_properties
+
 local quark_from_string = repo.GLib.quark_from_string
 local signal_lookup = repo.GObject.signal_lookup
 local signal_connect_closure_by_id = repo.GObject.signal_connect_closure_by_id
 local signal_emitv = repo.GObject.signal_emitv
+
+-- Cache of signal ids, keyed by gtype and signal name, and cache of
+-- detail quarks, keyed by detail string.
+local signal_ids, detail_quarks = {}, {}
+local function get_signal_id(name, gtype)
+   local ids = signal_ids[gtype]
+   if not ids then
+      ids = {}
+      signal_ids[gtype] = ids
+   end
+   local id = ids[name]
+   if not id then
+      -- Failed lookups are not cached, the signal can still be added
+      -- to the type later.
+      id = signal_lookup(name, gtype)
+      if id ~= 0 then ids[name] = id end
+   end
+   return id
+end
+local function get_detail_quark(detail)
+   if not detail then return 0 end
+   local quark = detail_quarks[detail]
+   if not quark then
+      quark = quark_from_string(detail)
+      detail_quarks[detail] = quark
+   end
+   return quark
+end
+
 -- Connects signal to specified object instance.
 local function connect_signal(obj, gtype, name, closure, detail, after)
    return signal_connect_closure_by_id(
-      obj, signal_lookup(name, gtype),
-      detail and quark_from_string(detail) or 0,
+      obj, get_signal_id(name, gtype), get_detail_quark(detail),
       closure, after or false)
 end
 -- Emits signal on specified object instance.
 local function emit_signal(obj, gtype, info, detail, ...)
-   -- Compile callable info.
-   local call_info = Closure.CallInfo.new(info)
+   -- Get compiled callable info.
+   local call_info = Closure.CallInfo.get(info)
 
    -- Marshal input arguments.
    local retval, params, marshalling_params = call_info:pre_call(obj, ...)
 
    -- Invoke the signal.
-   signal_emitv(params, signal_lookup(info.name, gtype),
-		detail and quark_from_string(detail) or 0, retval)
+   signal_emitv(params, get_signal_id(info.name, gtype),
+		get_detail_quark(detail), retval)
+
+   -- Unmarshal results and recycle used values.
+   return call_info:release(
+      retval, params, call_info:post_call(params, retval, marshalling_params))
+end
+
+-- Signal pad, yielded by reading the signal.  Pad holds the object,
+-- its gtype and signal info, operations are shared by all pads.
+local signal_pad = {}
+function signal_pad:connect(target, detail, after)
+   return connect_signal(self[1], self[2], self[3].name,
+			 Closure(target, self[3]), detail, after)
+end
+function signal_pad:emit(...)
+   return emit_signal(self[1], self[2], self[3], nil, ...)
+end
+local signal_pad_mt = { __index = signal_pad }
+function signal_pad_mt:__call(_, ...)
+   return emit_signal(self[1], self[2], self[3], nil, ...)
+end
 
-   -- Unmarshal results.
-   return call_info:post_call(params, retval, marshalling_params)
+-- Pad of signal supporting details, implements __newindex for
+-- connecting in the 'on_signal['detail'] = handler' form.
+local detailed_signal_pad = setmetatable({}, signal_pad_mt)
+function detailed_signal_pad:emit(detail, ...)
+   return emit_signal(self[1], self[2], self[3], detail, ...)
 end
+local detailed_signal_pad_mt = { __index = detailed_signal_pad,
+				 __call = signal_pad_mt.__call }
+function detailed_signal_pad_mt:__newindex(detail, target)
+   connect_signal(self[1], self[2], self[3].name,
+		  Closure(target, self[3]), detail)
+end
+
+-- Cache of pad metatables, keyed by signal info.
+local signal_pad_mts = setmetatable({}, { __mode = 'k' })
 
 -- Signal accessor.
 function Object:_access_signal(object, info, ...)
@@ -323,34 +393,13 @@ function Object:_access_signal(object, info, ...)
       connect_signal(object, gtype, info.name, Closure((...), info))
    else
       -- Reading yields table with signal operations.
-      local mt = {}
-      local pad = setmetatable({}, mt)
-      function pad:connect(target, detail, after)
-	 return connect_signal(object, gtype, info.name,
-			       Closure(target, info), detail, after)
-      end
-      function pad:emit(...)
-	 return emit_signal(object, gtype, info, nil, ...)
+      local mt = signal_pad_mts[info]
+      if not mt then
+	 mt = ((not info.is_signal or info.flags.detailed)
+	       and detailed_signal_pad_mt or signal_pad_mt)
+	 signal_pad_mts[info] = mt
       end
-      function mt:__call(_, ...)
-	 return emit_signal(object, gtype, info, nil, ...)
-      end
-
-      -- If signal supports details, add metatable implementing
-      -- __newindex for connecting in the 'on_signal['detail'] =
-      -- handler' form.
-      if not info.is_signal or info.flags.detailed then
-	 function pad:emit(detail, ...)
-	    return emit_signal(object, gtype, info, detail, ...)
-	 end
-	 function mt:__newindex(detail, target)
-	    connect_signal(object, gtype, info.name, Closure(target, info),
-			   detail)
-	 end
-      end
-
-      -- Return created signal pad.
-      return pad
+      return setmetatable({ object, gtype, info }, mt)
    end
 end
 
@@ -51,23 +51,17 @@ typedef struct _Record
   };
 } Record;
 
-/* lightuserdata key to LUA_REGISTRYINDEX containing metatable for
-   record. */
-static int record_mt;
-
-/* lightuserdata key to cache table containing
-   lightuserdata(record->addr) -> weak(record) */
-static int record_cache;
-
-/* lightuserdata key to cache table containing
-   recordproxy(weak) -> parent */
-static int parent_cache;
+/* Metatable for record and the caches below are referenced from
+   per-state block, see LuaGObjectState:
+   record_cache: lightuserdata(record->addr) -> weak(record)
+   parent_cache: recordproxy(weak) -> parent */
 
 gpointer
 lua_gobject_record_new (lua_State *L, int count, gboolean alloc)
 {
   Record *record;
   size_t size;
+  LuaGObjectState *state = lua_gobject_state_get (L);
 
   luaL_checkstack (L, 4, "");
 
@@ -80,8 +74,7 @@ lua_gobject_record_new (lua_State *L, int count, gboolean alloc)
      metatable. */
   record = lua_newuserdata (L, G_STRUCT_OFFSET (Record, data) +
 			    (alloc ? 0 : size));
-  lua_pushlightuserdata (L, &record_mt);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, state, record_mt);
   lua_setmetatable (L, -2);
   if (G_LIKELY (!alloc))
     {
@@ -100,8 +93,7 @@ lua_gobject_record_new (lua_State *L, int count, gboolean alloc)
   lua_setfenv (L, -2);
 
   /* Store newly created record into the cache. */
-  lua_pushlightuserdata (L, &record_cache);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, state, record_cache);
   lua_pushlightuserdata (L, record->addr);
   lua_pushvalue (L, -3);
   lua_rawset (L, -3);
@@ -171,6 +163,7 @@ void
 lua_gobject_record_2lua (lua_State *L, gpointer addr, gboolean own, int parent)
 {
   Record *record;
+  LuaGObjectState *state;
 
   luaL_checkstack (L, 5, "");
 
@@ -189,8 +182,8 @@ lua_gobject_record_2lua (lua_State *L, gpointer addr, gboolean own, int parent)
     lua_gobject_makeabs (L, parent);
 
   /* Prepare access to cache. */
-  lua_pushlightuserdata (L, &record_cache);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  state = lua_gobject_state_get (L);
+  lua_gobject_state_push (L, state, record_cache);
 
   /* Check whether the record is already cached. */
   lua_pushlightuserdata (L, addr);
@@ -219,16 +212,14 @@ lua_gobject_record_2lua (lua_State *L, gpointer addr, gboolean own, int parent)
   /* Allocate new userdata for record object, attach proper
      metatable. */
   record = lua_newuserdata (L, G_STRUCT_OFFSET (Record, data));
-  lua_pushlightuserdata (L, &record_mt);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, state, record_mt);
   lua_setmetatable (L, -2);
   record->addr = addr;
   if (parent != 0)
     {
       /* Store reference to the parent argument into parent reference
 	 cache. */
-      lua_pushlightuserdata (L, &parent_cache);
-      lua_rawget (L, LUA_REGISTRYINDEX);
+      lua_gobject_state_push (L, state, parent_cache);
       lua_pushvalue (L, -2);
       lua_pushvalue (L, parent);
       lua_rawset (L, -3);
@@ -286,15 +277,14 @@ lua_gobject_record_2lua (lua_State *L, gpointer addr, gboolean own, int parent)
 /* Checks that given argument is Record userdata and returns pointer
    to it. Returns NULL if narg has bad type. */
 static Record *
-record_check (lua_State *L, int narg)
+record_check (lua_State *L, LuaGObjectState *state, int narg)
 {
   /* Check using metatable that narg is really Record type. */
   Record *record = lua_touserdata (L, narg);
   luaL_checkstack (L, 3, "");
   if (!lua_getmetatable (L, narg))
     return NULL;
-  lua_pushlightuserdata (L, &record_mt);
-  lua_rawget (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_push (L, state, record_mt);
   if (!lua_equal (L, -1, -2))
     record = NULL;
   lua_pop (L, 2);
@@ -315,9 +305,9 @@ record_error (lua_State *L, int narg, const gchar *expected_name)
 
 /* Similar to record_check, but throws in case of failure. */
 static Record *
-record_get (lua_State *L, int narg)
+record_get (lua_State *L, LuaGObjectState *state, int narg)
 {
-  Record *record = record_check (L, narg);
+  Record *record = record_check (L, state, narg);
   if (record == NULL)
     record_error (L, narg, NULL);
 
@@ -336,7 +326,7 @@ lua_gobject_record_2c (lua_State *L, int narg, gpointer target, gboolean by_valu
       /* Get record and check its type. */
       lua_gobject_makeabs (L, narg);
       luaL_checkstack (L, 4, "");
-      record = record_check (L, narg);
+      record = record_check (L, lua_gobject_state_get (L), narg);
       if (record)
 	{
 	  /* Check, whether type fits. Also take into account possible
@@ -421,7 +411,7 @@ lua_gobject_record_2c (lua_State *L, int narg, gpointer target, gboolean by_valu
 static int
 record_gc (lua_State *L)
 {
-  Record *record = record_get (L, 1);
+  Record *record = record_get (L, lua_touserdata (L, lua_upvalueindex (1)), 1);
 
   if (record->store == RECORD_STORE_EMBEDDED
       || record->store == RECORD_STORE_NESTED)
@@ -454,7 +444,7 @@ record_gc (lua_State *L)
 static int
 record_tostring (lua_State *L)
 {
-  Record *record = record_get (L, 1);
+  Record *record = record_get (L, lua_touserdata (L, lua_upvalueindex (1)), 1);
   lua_getfenv (L, 1);
   lua_getfield (L, -1, "_tostring");
   if (lua_isnil (L, -1))
@@ -476,17 +466,270 @@ record_tostring (lua_State *L)
   return 1;
 }
 
+/* Compiled accessor of record field, which can be accessed by a plain
+   memory load or store instead of going through GI and Lua.
+   Descriptors are cached by field name in '_fielddesc' table of the
+   typetable; other elements and fields which cannot be compiled are
+   cached as 'false'.  The cache is dropped whenever the typetable is
+   modified.  Typetable of embedded record is kept in descriptor's
+   environment table. */
+typedef struct _FieldDesc
+{
+  /* Offset of the field in the record. */
+  gsize offset;
+
+  /* Type tag and size of the scalar field. */
+  guint tag : 5;
+  guint size : 4;
+
+  /* Access flags of the field. */
+  guint readable : 1;
+  guint writable : 1;
+
+  /* Set when the field is embedded record. */
+  guint nested : 1;
+} FieldDesc;
+
+/* Compiles field info at index narg into descriptor and pushes it, or
+   pushes false if the field has to be accessed through Lua. */
+static void
+record_field_compile (lua_State *L, int narg)
+{
+  GIFieldInfo **fi = lua_gobject_udata_test (L, narg, LUA_GOBJECT_GI_INFO);
+  GIFieldInfoFlags flags;
+  GITypeInfo *ti;
+  GIBaseInfo *ii = NULL;
+  FieldDesc *desc;
+  GITypeTag tag;
+  gsize size = 0;
+
+  if (fi == NULL || !GI_IS_FIELD_INFO (*fi))
+    {
+      lua_pushboolean (L, FALSE);
+      return;
+    }
+
+  /* Only scalars and embedded records have fixed layout. */
+  ti = gi_field_info_get_type_info (*fi);
+  tag = gi_type_info_get_tag (ti);
+  if (!gi_type_info_is_pointer (ti))
+    switch (tag)
+      {
+      case GI_TYPE_TAG_BOOLEAN:
+	size = sizeof (gboolean);
+	break;
+
+      case GI_TYPE_TAG_UNICHAR:
+	size = sizeof (gunichar);
+	break;
+
+      case GI_TYPE_TAG_GTYPE:
+	size = sizeof (GType);
+	break;
+
+      case GI_TYPE_TAG_INTERFACE:
+	ii = gi_type_info_get_interface (ti);
+	if (!GI_IS_STRUCT_INFO (ii) && !GI_IS_UNION_INFO (ii))
+	  {
+	    gi_base_info_unref (ii);
+	    ii = NULL;
+	  }
+	break;
+
+      default:
+	size = lua_gobject_array_elt_size (tag);
+	break;
+      }
+  gi_base_info_unref (ti);
+  if (size == 0 && ii == NULL)
+    {
+      lua_pushboolean (L, FALSE);
+      return;
+    }
+
+  desc = lua_newuserdata (L, sizeof (FieldDesc));
+  flags = gi_field_info_get_flags (*fi);
+  desc->offset = gi_field_info_get_offset (*fi);
+  desc->tag = tag;
+  desc->size = size;
+  desc->readable = (flags & GI_FIELD_IS_READABLE) != 0;
+  desc->writable = (flags & GI_FIELD_IS_WRITABLE) != 0;
+  desc->nested = ii != NULL;
+  lua_newtable (L);
+  if (ii != NULL)
+    {
+      /* Assigning tables to embedded records is left to Lua. */
+      desc->writable = FALSE;
+      lua_gobject_type_get_repotype (L, G_TYPE_INVALID, ii);
+      lua_rawseti (L, -2, 1);
+      gi_base_info_unref (ii);
+    }
+  lua_setfenv (L, -2);
+}
+
+/* Pushes descriptor of the field named by the string at index 2 of
+   the record at index 1, whose typetable is at index typetable.
+   Pushes false if the field cannot be accessed directly. */
+static void
+record_field_desc (lua_State *L, int typetable)
+{
+  int cache, mt;
+
+  luaL_checkstack (L, 8, "");
+  lua_pushliteral (L, "_fielddesc");
+  lua_rawget (L, typetable);
+  if (lua_isnil (L, -1))
+    {
+      lua_pop (L, 1);
+      lua_newtable (L);
+      lua_pushliteral (L, "_fielddesc");
+      lua_pushvalue (L, -2);
+      lua_rawset (L, typetable);
+    }
+  cache = lua_gettop (L);
+  lua_pushvalue (L, 2);
+  lua_rawget (L, cache);
+  if (!lua_isnil (L, -1))
+    {
+      lua_remove (L, cache);
+      return;
+    }
+  lua_pop (L, 1);
+
+  /* Cache miss, resolve the element using typetable's _element
+     method.  Only plain fields handled by unmodified _access and
+     _access_field of the record metatable can be compiled. */
+  lua_pushboolean (L, FALSE);
+  if (!lua_getmetatable (L, typetable))
+    {
+      lua_remove (L, cache);
+      return;
+    }
+  mt = lua_gettop (L);
+  lua_getfield (L, typetable, "_access");
+  lua_getfield (L, mt, "_access");
+  lua_getfield (L, typetable, "_access_field");
+  lua_getfield (L, mt, "_access_field");
+  lua_getfield (L, typetable, "_element");
+  if (lua_rawequal (L, -5, -4) && lua_rawequal (L, -3, -2)
+      && !lua_isnil (L, -2) && !lua_isnil (L, -1))
+    {
+      lua_pushvalue (L, typetable);
+      lua_pushvalue (L, 1);
+      lua_pushvalue (L, 2);
+      lua_call (L, 3, 2);
+      if (lua_type (L, -1) == LUA_TSTRING
+	  && strcmp (lua_tostring (L, -1), "_field") == 0)
+	{
+	  record_field_compile (L, -2);
+	  lua_replace (L, mt - 1);
+	}
+    }
+  lua_settop (L, mt - 1);
+
+  /* Store the descriptor and leave it on the stack.  Misses are stored
+     too, so that methods and other elements do not call _element on
+     every access; component.mt:__newindex drops the whole cache when
+     the typetable changes. */
+  lua_pushvalue (L, 2);
+  lua_pushvalue (L, -2);
+  lua_rawset (L, cache);
+  lua_remove (L, cache);
+}
+
+/* Tries to access field named by the string at index 2 of the record
+   at index 1 using compiled field descriptor.  Returns FALSE if the
+   access has to go through typetable's _access method. */
+static gboolean
+record_field_cached (lua_State *L, Record *record, gboolean getmode,
+		     int typetable)
+{
+  FieldDesc *desc;
+  gpointer addr;
+  GIArgument arg;
+
+  record_field_desc (L, typetable);
+  desc = lua_touserdata (L, -1);
+  if (desc == NULL || !(getmode ? desc->readable : desc->writable))
+    {
+      lua_pop (L, 1);
+      return FALSE;
+    }
+
+  addr = (gchar *) record->addr + desc->offset;
+  if (desc->nested)
+    {
+      lua_getfenv (L, -1);
+      lua_rawgeti (L, -1, 1);
+      lua_gobject_record_2lua (L, addr, FALSE, 1);
+      lua_replace (L, -3);
+      lua_pop (L, 1);
+    }
+  else if (getmode)
+    {
+      lua_pop (L, 1);
+      memcpy (&arg, addr, desc->size);
+      switch (desc->tag)
+	{
+	case GI_TYPE_TAG_BOOLEAN:
+	  lua_pushboolean (L, arg.v_boolean);
+	  break;
+
+	case GI_TYPE_TAG_FLOAT:
+	  lua_pushnumber (L, arg.v_float);
+	  break;
+
+	case GI_TYPE_TAG_DOUBLE:
+	  lua_pushnumber (L, arg.v_double);
+	  break;
+
+	default:
+	  lua_gobject_marshal_2lua_int (L, desc->tag, &arg, 0);
+	  break;
+	}
+    }
+  else
+    {
+      lua_pop (L, 1);
+      switch (desc->tag)
+	{
+	case GI_TYPE_TAG_BOOLEAN:
+	  arg.v_boolean = lua_toboolean (L, 3) ? TRUE : FALSE;
+	  break;
+
+	case GI_TYPE_TAG_FLOAT:
+	  arg.v_float = (gfloat) luaL_checknumber (L, 3);
+	  break;
+
+	case GI_TYPE_TAG_DOUBLE:
+	  arg.v_double = luaL_checknumber (L, 3);
+	  break;
+
+	default:
+	  lua_gobject_marshal_2c_int (L, desc->tag, &arg, 3, FALSE, 0);
+	  break;
+	}
+      memcpy (addr, &arg, desc->size);
+    }
+  return TRUE;
+}
+
 /* Worker method for __index and __newindex implementation. */
 static int
 record_access (lua_State *L)
 {
   gboolean getmode = lua_isnone (L, 3);
+  Record *record;
 
   /* Check that 1st arg is a record and invoke one of the forms:
      result = type:_access(recordinstance, name)
      type:_access(recordinstance, name, val) */
-  record_get (L, 1);
+  record = record_get (L, lua_touserdata (L, lua_upvalueindex (1)), 1);
   lua_getfenv (L, 1);
+  if (lua_type (L, 2) == LUA_TSTRING
+      && record_field_cached (L, record, getmode, lua_gettop (L)))
+    return getmode ? 1 : 0;
+
   return lua_gobject_marshal_access (L, getmode, 1, 2, 3);
 }
 
@@ -495,7 +738,7 @@ static int
 record_len (lua_State *L)
 {
   /* Check record, get its typetable and try to invoke _len method. */
-  record_get (L, 1);
+  record_get (L, lua_touserdata (L, lua_upvalueindex (1)), 1);
   lua_getfenv (L, 1);
   lua_getfield (L, -1, "_len");
   if (lua_isnil (L, -1))
@@ -571,7 +814,7 @@ record_query (lua_State *L)
   int mode = luaL_checkoption (L, 2, query_modes[0], query_modes);
   if (mode < 2)
     {
-      record = record_check (L, 1);
+      record = record_check (L, lua_gobject_state_get (L), 1);
       if (!record)
 	return 0;
 
@@ -592,7 +835,7 @@ record_query (lua_State *L)
     {
       if (lua_isnoneornil (L, 3))
 	{
-	  record = record_check (L, 1);
+	  record = record_check (L, lua_gobject_state_get (L), 1);
 	  if (!record)
 	    return 0;
 
@@ -623,7 +866,7 @@ record_field (lua_State *L)
   getmode = lua_isnone (L, 3);
 
   /* Get record instance. */
-  record = record_get (L, 1);
+  record = record_get (L, lua_gobject_state_get (L), 1);
 
   /* Call field marshalling worker. */
   lua_getfenv (L, 1);
@@ -635,7 +878,7 @@ record_field (lua_State *L)
 static int
 record_cast (lua_State *L)
 {
-  Record *record = record_get (L, 1);
+  Record *record = record_get (L, lua_gobject_state_get (L), 1);
   luaL_checktype (L, 2, LUA_TTABLE);
   lua_gobject_record_2lua (L, record->addr, FALSE, 1);
   return 1;
@@ -648,7 +891,7 @@ record_cast (lua_State *L)
 static int
 record_fromarray (lua_State *L)
 {
-  Record *record = record_get (L, 1);
+  Record *record = record_get (L, lua_gobject_state_get (L), 1);
   int index = luaL_checkinteger (L, 2);
   int parent = 0;
   gboolean own = FALSE;
@@ -665,8 +908,7 @@ record_fromarray (lua_State *L)
   else if (record->store == RECORD_STORE_NESTED)
     {
       /* Share parent with the original record. */
-      lua_pushlightuserdata (L, &parent_cache);
-      lua_rawget (L, LUA_REGISTRYINDEX);
+      lua_gobject_state_push (L, lua_gobject_state_get (L), parent_cache);
       lua_pushvalue (L, 1);
       lua_rawget (L, -2);
       parent = -2;
@@ -688,7 +930,7 @@ record_fromarray (lua_State *L)
 static int
 record_set (lua_State *L)
 {
-  Record *record = record_get (L, 1);
+  Record *record = record_get (L, lua_gobject_state_get (L), 1);
   if (lua_type (L, 2) == LUA_TTABLE)
     {
       /* Assign new typeinfo to the record instance. */
@@ -744,15 +986,18 @@ record_value_copy (const GValue *src, GValue *dest)
 void
 lua_gobject_record_init (lua_State *L)
 {
+  LuaGObjectState *state = lua_gobject_state_get (L);
+
   /* Register record metatable. */
-  lua_pushlightuserdata (L, &record_mt);
   lua_newtable (L);
-  luaL_register (L, NULL, record_meta_reg);
-  lua_rawset (L, LUA_REGISTRYINDEX);
+  lua_gobject_state_register (L, state, record_meta_reg);
+  state->record_mt = luaL_ref (L, LUA_REGISTRYINDEX);
 
   /* Create caches. */
-  lua_gobject_cache_create (L, &record_cache, "v");
-  lua_gobject_cache_create (L, &parent_cache, "k");
+  lua_gobject_cache_create (L, "v");
+  state->record_cache = luaL_ref (L, LUA_REGISTRYINDEX);
+  lua_gobject_cache_create (L, "k");
+  state->parent_cache = luaL_ref (L, LUA_REGISTRYINDEX);
 
   /* Create 'record' API table in main core API table. */
   lua_newtable (L);
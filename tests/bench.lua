@@ -0,0 +1,214 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject headless call micro-benchmark, driven by libregress.
+--
+--  Usage: lua tests/bench.lua [-o output.json] [-b baseline.json] [pattern]
+--
+--  Every benchmark is run for a fixed number of iterations (scaled by
+--  LUA_GOBJECT_BENCH_SCALE environment variable) and the result is
+--  written as JSON, one benchmark per line.  When a baseline file
+--  produced by an earlier run is given, relative change of calls per
+--  second is reported on stderr for every benchmark.
+--
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local LuaGObject = require 'LuaGObject'
+local GLib = LuaGObject.GLib
+local GObject = LuaGObject.GObject
+local R = LuaGObject.Regress
+
+-- Parse commandline.
+local output, baseline, pattern
+do
+   local i = 1
+   while i <= #arg do
+      if arg[i] == '-o' then
+	 i = i + 1
+	 output = arg[i]
+      elseif arg[i] == '-b' then
+	 i = i + 1
+	 baseline = arg[i]
+      else
+	 pattern = arg[i]
+      end
+      i = i + 1
+   end
+end
+
+local scale = tonumber(os.getenv('LUA_GOBJECT_BENCH_SCALE') or 1)
+
+-- Objects shared by the benchmarks.
+local obj = R.TestObj()
+local struct_a = R.TestStructA { some_int = 42, some_int8 = 12,
+				 some_double = 3.14, some_enum = 'VALUE2' }
+local struct_b = R.TestStructB()
+local int_array = { 1, 2, 3, 4, 5, 6, 7, 8 }
+local str_list = { '1', '2', '3' }
+local str_hash = { foo = 'bar', baz = 'bat', qux = 'quux' }
+local closure = GObject.Closure(function(int) return int end)
+local closure_result = GObject.Value('gint')
+local closure_args = { GObject.Value('gint', 43) }
+local signal_count = 0
+obj.on_test:connect(function() signal_count = signal_count + 1 end)
+obj.on_sig_with_int64_prop:connect(function(_, i) return i end)
+local function cb() return 42 end
+
+-- List of benchmarks, grouped by the shape of the call signature.
+-- Each entry is { name, iterations, function }.
+local benchmarks = {
+   -- Plain scalar arguments and return values.
+   { 'scalar_boolean', 200000, function() R.test_boolean(true) end },
+   { 'scalar_int', 200000, function() R.test_int(42) end },
+   { 'scalar_double', 200000, function() R.test_double(4.2) end },
+   { 'scalar_multi_double', 200000,
+     function() R.test_multi_double_args(1.5) end },
+   { 'scalar_gtype', 100000, function() R.test_gtype('GObject') end },
+
+   -- Strings in and out.
+   { 'string_in_out', 100000, function() R.test_utf('LuaGObject') end },
+   { 'string_int_out', 100000, function() R.test_int_out_utf8('abc') end },
+
+   -- Output arguments and caller-allocated structures.
+   { 'out_params', 100000,
+     function() obj:torture_signature_0(1, 'foo', 2) end },
+   { 'caller_allocates', 50000, function() struct_a:clone() end },
+
+   -- GError, both successful and failing path.
+   { 'gerror_ok', 100000,
+     function() obj:torture_signature_1(1, 'foo', 2) end },
+   { 'gerror_fail', 20000,
+     function() obj:torture_signature_1(1, 'foo', 3) end },
+
+   -- Arrays.
+   { 'array_int_in', 100000, function() R.test_array_int_in(int_array) end },
+   { 'array_int_out', 100000, function() R.test_array_int_out() end },
+   { 'array_fixed_out', 100000,
+     function() R.test_array_fixed_size_int_return() end },
+
+   -- GList, GSList and GHashTable.
+   { 'glist_in', 50000, function() R.test_glist_nothing_in(str_list) end },
+   { 'glist_return', 50000, function() R.test_glist_nothing_return() end },
+   { 'gslist_return', 50000, function() R.test_gslist_nothing_return() end },
+   { 'ghash_in', 50000, function() R.test_ghash_nothing_in(str_hash) end },
+   { 'ghash_return', 50000, function() R.test_ghash_nothing_return() end },
+
+   -- Callbacks of all scopes.
+   { 'callback_call', 50000, function() R.test_callback(cb) end },
+   { 'callback_user_data', 50000,
+     function() R.test_callback_user_data(cb) end },
+   { 'callback_notified', 20000,
+     function()
+	R.test_callback_destroy_notify(cb)
+	R.test_callback_thaw_notifications()
+     end },
+   { 'callback_async', 20000,
+     function()
+	R.test_callback_async(cb)
+	R.test_callback_thaw_async()
+     end },
+
+   -- GClosure invocation, from C and from Lua.
+   { 'closure_c_invoke', 50000,
+     function() R.test_closure_one_arg(closure, 43) end },
+   { 'closure_lua_invoke', 50000,
+     function() closure:invoke(closure_result, closure_args, nil) end },
+
+   -- Method invocation syntax and properties.
+   { 'method_call', 200000, function() obj:instance_method() end },
+   { 'static_method_call', 200000,
+     function() R.TestObj.instance_method(obj) end },
+   { 'property_get', 100000, function() local _ = obj.int end },
+   { 'property_set', 100000, function() obj.int = 42 end },
+
+   -- Record fields, plain and embedded.
+   { 'field_get', 200000, function() local _ = struct_a.some_int end },
+   { 'field_set', 200000, function() struct_a.some_int = 42 end },
+   { 'field_nested_get', 100000,
+     function() local _ = struct_b.nested_a.some_int end },
+
+   -- Signals, emitted from Lua and from C.
+   { 'signal_emit_lua', 50000, function() obj.on_test:emit() end },
+   { 'signal_emit_c', 50000, function() obj:emit_sig_with_int64() end },
+
+   -- Proxy creation.
+   { 'record_new', 100000, function() R.TestStructA() end },
+   { 'boxed_new', 100000, function() R.TestBoxed() end },
+   { 'object_new', 20000, function() R.TestObj() end },
+   { 'object_return', 20000,
+     function() R.TestObj.new_from_file('unused') end },
+}
+
+-- Loads calls per second from the baseline file.  The file is always
+-- the one produced by this script, so it is enough to match on its
+-- line-oriented layout instead of parsing generic JSON.
+local function load_baseline(filename)
+   local rates = {}
+   local file = assert(io.open(filename, 'r'))
+   for line in file:lines() do
+      local name, rate = line:match('"([%w_]+)":%s*{.-"rate":%s*([%d.eE+-]+)')
+      if name then rates[name] = tonumber(rate) end
+   end
+   file:close()
+   return rates
+end
+
+-- Runs all benchmarks matching the pattern and collects results.
+local results = {}
+for _, bench in ipairs(benchmarks) do
+   local name, count, func = bench[1], math.floor(bench[2] * scale), bench[3]
+   if not pattern or name:match(pattern) then
+      -- Warm up caches, so that first-call setup is not measured.
+      for _ = 1, 100 do func() end
+      collectgarbage()
+      local timer = GLib.Timer()
+      for _ = 1, count do func() end
+      timer:stop()
+      local elapsed = timer:elapsed()
+      results[#results + 1] = {
+	 name = name, calls = count, seconds = elapsed,
+	 rate = elapsed > 0 and count / elapsed or 0,
+      }
+   end
+end
+
+-- Produce JSON report.
+local lines = {}
+lines[#lines + 1] = '{'
+lines[#lines + 1] = ('  "lua": "%s",'):format(_VERSION)
+lines[#lines + 1] = ('  "scale": %g,'):format(scale)
+lines[#lines + 1] = '  "results": {'
+for i, res in ipairs(results) do
+   lines[#lines + 1] = ('    "%s": { "calls": %d, "seconds": %.6f, '
+			.. '"rate": %.1f }%s'):format(
+      res.name, res.calls, res.seconds, res.rate,
+      i < #results and ',' or '')
+end
+lines[#lines + 1] = '  }'
+lines[#lines + 1] = '}'
+local report = table.concat(lines, '\n') .. '\n'
+if output then
+   local file = assert(io.open(output, 'w'))
+   file:write(report)
+   file:close()
+else
+   io.write(report)
+end
+
+-- Compare against the baseline, if requested.
+if baseline then
+   local rates = load_baseline(baseline)
+   for _, res in ipairs(results) do
+      local base = rates[res.name]
+      if base and base > 0 then
+	 io.stderr:write(('%-24s %12.1f -> %12.1f calls/s  %+7.1f%%\n'):format(
+			    res.name, base, res.rate,
+			    (res.rate - base) / base * 100))
+      else
+	 io.stderr:write(('%-24s %12s -> %12.1f calls/s\n'):format(
+			    res.name, '-', res.rate))
+      end
+   end
+end
@@ -40,6 +40,21 @@ function gio.read()
     checkv(length, 0, "number")
 end
 
+function gio.read_buffer()
+   local GLib, Gio = LuaGObject.GLib, LuaGObject.Gio
+   local bytes = require 'bytes'
+   local stream = Gio.MemoryInputStream.new_from_bytes(GLib.Bytes.new('abc'))
+
+   -- Read-only view cannot be passed where C writes into it.
+   local view = GLib.Bytes.new('xyz').view
+   check(not pcall(stream.read, stream, view))
+   check(tostring(view) == 'xyz')
+
+   local buf = bytes.new(3)
+   checkv(stream:read(buf), 3, 'number')
+   check(tostring(buf) == 'abc')
+end
+
 function gio.async_access()
    local Gio = LuaGObject.Gio
    local res
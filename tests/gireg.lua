@@ -477,6 +477,76 @@ function gireg.array_gint8_in()
    check(not pcall(R.test_array_gint8_in, {'help'}))
 end
 
+function gireg.array_buffer_views_in()
+   local R = LuaGObject.Regress
+
+   -- Slices share memory with the sliced buffer.
+   local buf = bytes.new('0123')
+   local slice = buf:slice(2, 3)
+   check(#slice == 2 and slice[1] == 49)
+   check(R.test_array_gint8_in(slice) == 49 + 50)
+   slice[1] = 48
+   check(buf[2] == 48 and tostring(buf:slice(-2)) == '23')
+
+   -- Memory-mapped file.
+   local name = os.tmpname()
+   local file = io.open(name, 'wb')
+   file:write('0123')
+   file:close()
+   local map = bytes.map(name)
+   check(#map == 4 and tostring(map) == '0123')
+   check(R.test_array_gint8_in(map) == 48 + 49 + 50 + 51)
+   check(R.test_array_gint8_in(map:slice(4)) == 51)
+   check(not pcall(function() map[1] = 0 end))
+   map = nil
+   collectgarbage()
+
+   -- Writes to writable mapping are stored into the file.
+   if package.config:sub(1, 1) == '/' then
+      map = bytes.map(name, true)
+      check(#map == 4)
+      map[1] = 57
+      map = nil
+      collectgarbage()
+      file = io.open(name, 'rb')
+      check(file:read('*a') == '9123')
+      file:close()
+   end
+   os.remove(name)
+   check(bytes.map(name) == nil)
+end
+
+function gireg.buffer_bulk()
+   local buf = bytes.new(16)
+
+   -- Numbers at offsets, in both byte orders.
+   buf:set('guint32', 1, 0x01020304, 'be')
+   check(buf[1] == 1 and buf[4] == 4)
+   check(buf:get('guint32', 1, 'le') == 0x04030201)
+   check(buf:get('guint16', 3, 'be') == 0x0304)
+   buf:set('gint8', 5, -2)
+   check(buf:get('gint8', 5) == -2 and buf[5] == 254)
+   buf:set('gdouble', 9, 1.5, 'le')
+   check(buf:get('gdouble', 9, 'le') == 1.5)
+   check(not pcall(buf.get, buf, 'guint32', 14))
+   check(not pcall(buf.get, buf, 'gstring', 1))
+
+   -- Copy, fill, search and compare.
+   buf:fill(0)
+   buf:copy(3, 'hello world', 1, 5)
+   check(tostring(buf:slice(3, 7)) == 'hello')
+   buf:copy(1, buf, 3, 7)
+   check(tostring(buf:slice(1, 5)) == 'hello')
+   buf:fill(33, 6, 6)
+   check(buf[6] == 33)
+   check(buf:find('llo') == 3 and buf:find('llo', 4) == nil)
+   check(buf:find(bytes.new('h')) == 1 and buf:find('x') == nil)
+   check(buf:slice(1, 5):compare('hello') == 0)
+   check(buf:slice(1, 5):compare('hellp') < 0)
+   check(buf:slice(1, 5):compare('hell') > 0)
+   check(not pcall(buf.copy, buf, 15, 'abc'))
+end
+
 function gireg.array_gint16_in()
    local R = LuaGObject.Regress
    check(R.test_array_gint16_in{1,2,3} == 6)
@@ -600,6 +670,59 @@ function gireg.array_int_full_out()
    check(#{R.test_array_int_full_out()} == 1)
 end
 
+function gireg.array_views()
+   local R = LuaGObject.Regress
+   R.test_array_int_full_out.array_views = true
+   R.test_array_fixed_size_int_return.array_views = true
+   R.test_array_int_out.array_views = true
+
+   -- Owned array, taken over without copying.
+   local a = R.test_array_int_full_out()
+   check(type(a) == 'userdata' and a.type == 'gint32' and #a == 5)
+   check(a[1] == 0 and a[2] == 1 and a[3] == 2 and a[4] == 3 and a[5] == 4)
+   check(a[0] == nil and a[6] == nil)
+   a[1] = 42
+   check(a[1] == 42)
+   check(not pcall(function() a[6] = 1 end))
+
+   -- Slices share data with the viewed array.
+   local s = a:slice(2, -2)
+   check(#s == 3 and s[1] == 1 and s[3] == 3)
+   s[1] = 7
+   check(a[2] == 7)
+   check(#a:slice(4, 2) == 0)
+
+   -- Conversion to a table on demand.
+   local t = R.test_array_fixed_size_int_return():totable()
+   check(type(t) == 'table' and #t == 5 and t[5] == 4)
+   check(#R.test_array_int_out() == 5)
+
+   R.test_array_int_full_out.array_views = false
+   R.test_array_fixed_size_int_return.array_views = false
+   R.test_array_int_out.array_views = false
+   check(type(R.test_array_int_out()) == 'table')
+end
+
+function gireg.array_typed_in()
+   local R = LuaGObject.Regress
+   R.test_array_int_full_out.array_views = true
+   local a = R.test_array_int_full_out()
+   R.test_array_int_full_out.array_views = false
+
+   -- Typed arrays of matching type are accepted in place of tables.
+   check(R.test_array_int_in(a) == 10)
+   check(R.test_array_int_in(a:slice(2, 3)) == 3)
+   check(R.test_array_gint32_in(a) == 10)
+   check(not pcall(R.test_array_gint16_in, a))
+
+   -- Tables of numbers still work for all element sizes.
+   check(R.test_array_gint8_in { 1, 2, 3 } == 6)
+   check(R.test_array_gint16_in { 1, 2, 3 } == 6)
+   check(R.test_array_gint64_in { 1, 2, 3 } == 6)
+   check(not pcall(R.test_array_gint8_in, { 1, 1000 }))
+   check(not pcall(R.test_array_gint16_in, { 1, 'x' }))
+end
+
 function gireg.array_int_null_in()
    local R = LuaGObject.Regress
    R.test_array_int_null_in()
@@ -766,6 +889,125 @@ function gireg.ghash_everything_return()
    check(h.foo == 'bar' and h.baz == 'bat' and h.qux == 'quux')
 end
 
+function gireg.lazy_containers()
+   local R = LuaGObject.Regress
+   local funcs = { R.test_glist_everything_return,
+		   R.test_gslist_everything_return,
+		   R.test_glist_container_return,
+		   R.test_ghash_everything_return }
+   for _, func in ipairs(funcs) do func.lazy_containers = true end
+
+   -- Lists with full transfer are proxied.
+   local l = R.test_glist_everything_return()
+   check(type(l) == 'userdata' and #l == 3)
+   check(l[3] == '3' and l[1] == '1' and l[2] == '2' and l[4] == nil)
+   local t = R.test_gslist_everything_return():totable()
+   check(type(t) == 'table' and #t == 3 and t[2] == '2')
+   local n = 0
+   for i, v in l:pairs() do
+      n = n + 1
+      check(v == tostring(i))
+   end
+   check(n == 3)
+
+   -- ipairs() stops at the end of the list; hash tables iterate as
+   -- empty.
+   local ipairs_l = getmetatable(l).__ipairs
+   n = 0
+   for i, v in ipairs_l(l) do
+      n = n + 1
+      check(v == tostring(i))
+   end
+   check(n == 3)
+
+   -- Elements never accessed are released with the proxy.
+   l = R.test_glist_everything_return()
+   check(l[2] == '2')
+   l = nil
+   collectgarbage()
+
+   -- Borrowed elements are still converted eagerly.
+   check(type(R.test_glist_container_return()) == 'table')
+
+   -- Hash tables look keys up in the hash table itself.
+   local h = R.test_ghash_everything_return()
+   check(type(h) == 'userdata' and #h == 3)
+   check(h.foo == 'bar' and h.baz == 'bat' and h.qux == 'quux')
+   check(h.none == nil)
+   t = h:totable()
+   check(size_htab(t) == 3 and t.qux == 'quux')
+   for _ in ipairs_l(h) do check(false) end
+
+   for _, func in ipairs(funcs) do func.lazy_containers = false end
+   check(type(R.test_glist_everything_return()) == 'table')
+end
+
+function gireg.native_containers()
+   local R = LuaGObject.Regress
+   local types = require('LuaGObject.ffi').types
+
+   -- Lists and hash tables built from Lua are passed as they are.
+   local l = LuaGObject.container.list(types.utf8)
+   for i = 1, 3 do l[#l + 1] = tostring(i) end
+   check(#l == 3 and l[2] == '2')
+   R.test_glist_nothing_in(l)
+   check(#l == 3 and l[3] == '3')
+   check(not pcall(function() l[5] = '5' end))
+   local sl = LuaGObject.container.slist(types.utf8)
+   for i = 1, 3 do sl[i] = tostring(i) end
+   R.test_gslist_nothing_in(sl)
+   local h = LuaGObject.container.hash(types.utf8, types.utf8)
+   h.foo, h.baz, h.qux = 'bar', 'bat', 'quux'
+   check(#h == 3 and h.baz == 'bat')
+   R.test_ghash_nothing_in(h)
+   h.extra = 'value'
+   check(#h == 4)
+   h.extra = nil
+   check(#h == 3 and h.extra == nil)
+
+   -- Replacing an element does not leave stale cached value.
+   l[2] = 'two'
+   check(l[2] == 'two')
+   l[2] = '2'
+
+   -- Lazy proxies are passed back without conversion.
+   local get = R.test_glist_everything_return
+   get.lazy_containers = true
+   R.test_glist_nothing_in(get())
+   get.lazy_containers = false
+
+   -- Containers of different element type go through a table.
+   local sl2 = LuaGObject.container.slist(types.utf8)
+   for i = 1, 3 do sl2[i] = tostring(i) end
+   R.test_glist_nothing_in(sl2)
+   check(not pcall(LuaGObject.container.list, types.double))
+
+   -- Pointer arrays are passed as they are; full transfer gives the
+   -- container away and leaves the proxy empty.
+   local core = require 'LuaGObject.core'
+   local GLib = LuaGObject.GLib
+   local ptrarray = core.gi.Regress.test_garray_full_return.return_type
+   local ref = core.callable.new {
+      name = 'g_ptr_array_ref', addr = GLib.resolve.g_ptr_array_ref,
+      ret = types.ptr, ptrarray }
+   local unref = core.callable.new {
+      name = 'g_ptr_array_unref', addr = GLib.resolve.g_ptr_array_unref,
+      ret = types.void, types.ptr }
+   local take = core.callable.new {
+      name = 'g_ptr_array_unref', addr = GLib.resolve.g_ptr_array_unref,
+      ret = types.void, { ptrarray, xfer = true } }
+   local a = LuaGObject.container.ptrarray(types.utf8)
+   for i = 1, 3 do a[#a + 1] = tostring(i) end
+   check(#a == 3 and a[2] == '2')
+   local p1, p2 = ref(a), ref(a)
+   check(p1 == p2)
+   unref(p1)
+   unref(p2)
+   take(a)
+   check(#a == 0 and a[1] == nil)
+   check(not pcall(function() a[1] = '1' end))
+end
+
 function gireg.ghash_null_in()
    local R = LuaGObject.Regress
    R.test_ghash_null_in(nil)
@@ -898,6 +1140,36 @@ function gireg.struct_a()
    check(select('#', (function() local b = a.some_int end)()) == 0)
 end
 
+function gireg.struct_a_compiled_fields()
+   local R = LuaGObject.Regress
+   local a = R.TestStructA { some_int = 42, some_int8 = 12, some_double = 3.14 }
+   for _ = 1, 2 do
+      check(a.some_int == 42 and a.some_int8 == 12 and a.some_double == 3.14)
+   end
+   check(type(rawget(R.TestStructA, '_fielddesc')) == 'table')
+   check(not pcall(function() a.some_int8 = 1000 end))
+   check(a.some_int8 == 12)
+   a.some_int8 = -128
+   check(a.some_int8 == -128)
+
+   -- Only fields are compiled, other elements are cached as misses.
+   check(a.clone ~= nil)
+   check(rawget(rawget(R.TestStructA, '_fielddesc'), 'clone') == false)
+   check(a.clone ~= nil)
+
+   -- Modifying the typetable drops compiled fields.  The shared
+   -- typetable is restored even when the checks fail.
+   local ok, err = pcall(function()
+      R.TestStructA.some_int = 'shadowed'
+      check(rawget(R.TestStructA, '_fielddesc') == nil)
+      check(a.some_int == 'shadowed')
+   end)
+   rawset(R.TestStructA, 'some_int', nil)
+   rawset(R.TestStructA, '_fielddesc', nil)
+   check(ok, err)
+   check(a.some_int == 42)
+end
+
 function gireg.struct_a_clone()
    local R = LuaGObject.Regress
    local a = R.TestStructA { some_int = 42, some_int8 = 12, some_double = 3.14,
@@ -1360,6 +1632,153 @@ function gireg.obj_prop_dynamic()
    R.TestObj._property.int = old_prop
 end
 
+function gireg.obj_prop_batch()
+   local R = LuaGObject.Regress
+   local o = R.TestObj()
+   local pv = R.TestObj()
+
+   local notified = {}
+   o.on_notify:connect(function(_, pspec)
+	 notified[#notified + 1] = pspec.name
+   end)
+   o:set_properties { int = 42, double = 4.5, string = 'LuaGObject',
+		      bare = pv, boxed = R.TestBoxed() }
+   check(#notified == 5)
+   local int, double, string, bare, boxed =
+      o:get_properties { 'int', 'double', 'string', 'bare', 'boxed' }
+   check(int == 42 and double == 4.5 and string == 'LuaGObject')
+   check(bare == pv and boxed ~= nil)
+   check(select('#', o:get_properties {}) == 0)
+   check(not pcall(o.set_properties, o, { int = 'LuaGObject' }))
+   check(not pcall(o.set_properties, o, { nonexistent = 1 }))
+   check(not pcall(o.get_properties, o, { 'nonexistent' }))
+
+   -- Repeated updates of the same property in one batch are
+   -- coalesced into single notification, unlike separate sets.
+   notified = {}
+   o.int = 1
+   o.int = 2
+   check(#notified == 2)
+   notified = {}
+   o:set_properties { int = 3, double = 1.5,
+		      name_conflict = 4, ['name-conflict'] = 5 }
+   check(#notified == 3)
+   local seen = {}
+   for _, name in ipairs(notified) do
+      check(not seen[name])
+      seen[name] = true
+   end
+   check(seen['int'] and seen['double'] and seen['name-conflict'])
+end
+
+function gireg.obj_prop_native()
+   local core = require 'LuaGObject.core'
+   local R, Gio = LuaGObject.Regress, LuaGObject.Gio
+
+   -- Native accessor counting calls of its generic fallback.
+   local fallbacks = 0
+   local access = core.object.property(function(...)
+	 fallbacks = fallbacks + 1
+	 return R.TestObj._access_property(...)
+   end)
+   local function prop(typetable, obj, name, ...)
+      return access(typetable, obj, typetable._property[name], ...)
+   end
+
+   -- Scalar, string and object properties do not need the fallback.
+   local o, pv = R.TestObj(), R.TestObj()
+   prop(R.TestObj, o, 'int', 42)
+   check(prop(R.TestObj, o, 'int') == 42 and o.int == 42)
+   prop(R.TestObj, o, 'double', 4.5)
+   check(prop(R.TestObj, o, 'double') == 4.5)
+   prop(R.TestObj, o, 'string', 'LuaGObject')
+   check(prop(R.TestObj, o, 'string') == 'LuaGObject')
+   prop(R.TestObj, o, 'bare', pv)
+   check(prop(R.TestObj, o, 'bare') == pv)
+   check(not pcall(prop, R.TestObj, o, 'int', 'LuaGObject'))
+   check(fallbacks == 0)
+
+   -- Enums are marshalled natively by their symbolic names.
+   local client = Gio.SocketClient()
+   prop(Gio.SocketClient, client, 'family', 'IPV4')
+   check(prop(Gio.SocketClient, client, 'family') == 'IPV4')
+   prop(Gio.SocketClient, client, 'family', Gio.SocketFamily.IPV6)
+   check(client.family == 'IPV6')
+   check(fallbacks == 0)
+
+   -- Boxed property is left to the generic accessor.
+   local boxed = R.TestBoxed()
+   boxed.some_int8 = 7
+   prop(R.TestObj, o, 'boxed', boxed)
+   check(prop(R.TestObj, o, 'boxed').some_int8 == 7)
+   check(fallbacks == 2)
+end
+
+function gireg.obj_signal_emit()
+   local R = LuaGObject.Regress
+   local o = R.TestObj()
+
+   -- Repeated emission reuses compiled signal and its values.
+   local received
+   o.on_sig_with_obj:connect(function(_, obj) received = obj end)
+   for _ = 1, 3 do
+      local pv = R.TestObj()
+      o.on_sig_with_obj:emit(pv)
+      check(received == pv)
+   end
+
+   -- Nested emission of the same signal.
+   local depth = 0
+   o.on_test:connect(function()
+	 depth = depth + 1
+	 if depth < 3 then o.on_test:emit() end
+   end)
+   o:on_test()
+   check(depth == 3)
+end
+
+function gireg.obj_signal_native()
+   local core = require 'LuaGObject.core'
+   local R = LuaGObject.Regress
+   local o = R.TestObj()
+
+   -- Count closures getting the native marshaller.
+   local set_target, native = core.marshal.closure_set_target, 0
+   core.marshal.closure_set_target = function(...)
+      native = native + 1
+      return set_target(...)
+   end
+   local received
+   local ok, err = pcall(function()
+	 o.on_sig_with_int64_prop:connect(function(self, i)
+	       received = { self, i }
+	       return i + 1
+	 end)
+   end)
+   core.marshal.closure_set_target = set_target
+   check(ok, err)
+   check(native == 1)
+
+   -- Arguments and return value go through the native marshaller.
+   check(o.on_sig_with_int64_prop:emit(41) == 42)
+   check(received[1] == o and received[2] == 41)
+   check(o.on_sig_with_int64_prop:emit(-1) == 0)
+   check(received[2] == -1)
+
+   -- Handler connected from a coroutine which is suspended during
+   -- the emission runs in a borrowed thread.
+   local co = coroutine.create(function()
+	 o.on_sig_with_obj:connect(function(_, obj) received = obj end)
+	 coroutine.yield()
+   end)
+   coroutine.resume(co)
+   local pv = R.TestObj()
+   o.on_sig_with_obj:emit(pv)
+   check(received == pv)
+   check(coroutine.resume(co))
+   check(coroutine.status(co) == 'dead')
+end
+
 function gireg.obj_subobj()
    local R = LuaGObject.Regress
    local o = R.TestSubObj()
@@ -1453,6 +1872,78 @@ function gireg.callback_notified()
    check(R.test_callback_thaw_notifications() == 1)
 end
 
+function gireg.callback_intern()
+   local R = LuaGObject.Regress
+   local core = require 'LuaGObject.core'
+   local count = 0
+   local function cb() count = count + 1 return 1 end
+   R.test_callback_destroy_notify.intern_closures = true
+   check(R.test_callback_destroy_notify.intern_closures == true)
+   for _ = 1, 10 do check(R.test_callback_destroy_notify(cb) == 1) end
+   local blocks = core.callable.interned(cb)
+   check(#blocks == 1)
+   check(R.test_callback_destroy_notify(cb) == 1)
+   check(#core.callable.interned(cb) == 1)
+   check(core.callable.interned(cb)[1] == blocks[1])
+   check(R.test_callback_destroy_notify(function() return 2 end) == 2)
+
+   -- The same target passed as a different callback type gets its own
+   -- shared closure.
+   local GLib = LuaGObject.GLib
+   GLib.idle_add.intern_closures = true
+   local id1 = GLib.idle_add(GLib.PRIORITY_DEFAULT_IDLE, cb)
+   local id2 = GLib.idle_add(GLib.PRIORITY_DEFAULT_IDLE, cb)
+   local both = core.callable.interned(cb)
+   check(#both == 2)
+   check(both[1] ~= both[2])
+   check(both[1] == blocks[1] or both[2] == blocks[1])
+   GLib.source_remove(id1)
+   GLib.source_remove(id2)
+   GLib.idle_add.intern_closures = false
+   check(#core.callable.interned(cb) == 1)
+
+   collectgarbage()
+   check(R.test_callback_thaw_notifications() == 13)
+   check(count == 22)
+   check(#core.callable.interned(cb) == 0)
+   R.test_callback_destroy_notify.intern_closures = false
+end
+
+function gireg.callback_suspended()
+   local R = LuaGObject.Regress
+
+   -- Callbacks created by a coroutine run on pooled threads while the
+   -- coroutine is suspended, also when nested.
+   local co = coroutine.create(function()
+      for i = 1, 3 do
+	 R.test_callback_destroy_notify(function()
+	       return R.test_callback(function() return i end)
+	 end)
+      end
+      coroutine.yield()
+   end)
+   check(coroutine.resume(co))
+   check(coroutine.status(co) == 'suspended')
+   check(R.test_callback_thaw_notifications() == 6)
+
+   -- Errors cannot be rethrown into the suspended coroutine, they are
+   -- reported and the callback returns zero.
+   local GLib = LuaGObject.GLib
+   co = coroutine.create(function()
+      R.test_callback_destroy_notify(function() error('boom') end)
+      R.test_callback_destroy_notify(function() return 'nan' end)
+      coroutine.yield()
+   end)
+   check(coroutine.resume(co))
+   for _ = 1, 2 do
+      GLib.test_expect_message('LuaGObject', GLib.LogLevelFlags.LEVEL_WARNING,
+			       'Error raised while calling*')
+   end
+   check(R.test_callback_thaw_notifications() == 0)
+   GLib.test_assert_expected_messages_internal('LuaGObject', 'gireg.lua', 0,
+					       'callback_suspended')
+end
+
 function gireg.callback_async()
    local R = LuaGObject.Regress
    R.test_callback_async(function() return 1 end)
@@ -1460,3 +1951,99 @@ function gireg.callback_async()
    collectgarbage()
    check(R.test_callback_thaw_async() == 1)
 end
+
+function gireg.callback_reuse()
+   local R = LuaGObject.Regress
+
+   -- Closures of scope call are reused; each call must invoke its own
+   -- target, also when callback types alternate.
+   for i = 1, 50 do
+      check(R.test_callback(function() return i end) == i)
+      check(R.test_callback_user_data(function() return -i end) == -i)
+      local called
+      R.test_simple_callback(function() called = i end)
+      check(called == i)
+   end
+end
+
+function gireg.callable_nonblocking()
+   local R = LuaGObject.Regress
+   local core = require 'LuaGObject.core'
+   local test_int = R.test_int
+   check(not test_int.nonblocking)
+   test_int.nonblocking = true
+   check(test_int.nonblocking)
+   checkv(test_int(42), 42, 'number')
+   test_int.nonblocking = false
+   check(not test_int.nonblocking)
+
+   local test_callback = R.test_callback
+   core.callable.nonblocking_check(true)
+   check(test_callback(function() return 42 end) == 42)
+   check(core.callable.nonblocking_check(true) == 0)
+
+   -- Callback invoked from nonblocking call is reported.
+   local GLib = LuaGObject.GLib
+   GLib.test_expect_message('LuaGObject', GLib.LogLevelFlags.LEVEL_CRITICAL,
+			    'callback invoked during nonblocking call*')
+   test_callback.nonblocking = true
+   check(test_callback(function() return 42 end) == 42)
+   test_callback.nonblocking = false
+   GLib.test_assert_expected_messages_internal('LuaGObject', 'gireg.lua', 0,
+					       'callable_nonblocking')
+   check(core.callable.nonblocking_check(false) == 1)
+end
+
+function gireg.callable_batch()
+   local R = LuaGObject.Regress
+
+   -- Scalar callable, rows and columns.
+   local res = R.test_int:map { { 1 }, { 2 }, { 3 } }
+   check(#res == 3 and res[1] == 1 and res[2] == 2 and res[3] == 3)
+   res = R.test_int:call_many(2, { 4, 5 })
+   check(#res == 2 and res[1] == 4 and res[2] == 5)
+   check(#R.test_int:call_many(0, {}) == 0)
+   check(not pcall(R.test_int.call_many, R.test_int, 2, { 1, 'nan' }))
+
+   -- Non-table column is passed to all calls.
+   local o = R.TestObj()
+   res = R.TestObj.instance_method:call_many(3, o)
+   check(#res == 3 and res[1] == -1 and res[3] == -1)
+
+   -- Generic callable with output argument.
+   res = R.test_int_out_utf8:map { { 'a' }, { 'abc' } }
+   check(#res == 2 and res[1] == 1 and res[2] == 3)
+end
+
+function gireg.call_arena()
+   local R = LuaGObject.Regress
+
+   -- Temporaries of repeated calls are released and reused.
+   for i = 1, 100 do
+      check(R.test_array_int_in { i, 2, 3 } == i + 5)
+      R.test_glist_nothing_in { '1', '2', '3' }
+      R.test_ghash_nothing_in({ foo = 'bar', baz = 'bat', qux = 'quux' })
+   end
+
+   -- Calls nested in callback use their own temporaries.
+   check(R.test_callback_user_data(function()
+	    return R.test_array_int_in { 40, 2 }
+   end) == 42)
+
+   -- Failed marshalling does not break following calls.
+   check(not pcall(R.test_array_int_in, { 1, 'help' }))
+   check(R.test_array_int_in { 1, 2, 3 } == 6)
+
+   -- Arenas abandoned by failed calls disturb neither the arena of
+   -- the call in progress nor following calls, whether they are
+   -- collected or released by the enclosing call.
+   for _ = 1, 3 do
+      check(not pcall(R.test_glist_nothing_in, { '1', {} }))
+   end
+   check(R.test_callback_user_data(function()
+	    collectgarbage()
+	    check(not pcall(R.test_array_int_in, { 1, 'help' }))
+	    return R.test_array_int_in { 40, 2 }
+   end) == 42)
+   R.test_glist_nothing_in { '1', '2', '3' }
+end
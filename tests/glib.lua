@@ -45,6 +45,37 @@ function glib.timer()
    check(timer:elapsed() == el2)
 end
 
+function glib.bytes_zero_copy()
+   local GLib = LuaGObject.GLib
+   local bytes = require 'bytes'
+
+   -- Wrapping Lua string and binary buffer.
+   local b = GLib.Bytes.wrap('hello')
+   check(#b == 5 and b.data == 'hello')
+   local buf = bytes.new('world')
+   b = GLib.Bytes.wrap(buf)
+   buf[1] = 87
+   check(b.data == 'World')
+   b = nil
+   collectgarbage()
+
+   -- Read-only view of the data.
+   local view = GLib.Bytes.new('abc').view
+   collectgarbage()
+   check(#view == 3 and view[1] == 97 and view[3] == 99 and view[4] == nil)
+   check(tostring(view) == 'abc')
+   check(not pcall(function() view[1] = 0 end))
+
+   -- Read-only view is accepted as input generic pointer.
+   local GObject = LuaGObject.GObject
+   local val = GObject.Value(GObject.Type.POINTER, view)
+   check(type(val.value) == 'userdata')
+   local v = GLib.Variant('y', 65)
+   local buf = bytes.new('xyz')
+   GLib.Variant.store(v, buf:slice(2))
+   check(tostring(buf) == 'xAz')
+end
+
 function glib.markup_base()
    local MarkupParser = LuaGObject.GLib.MarkupParser
    local MarkupParseContext = LuaGObject.GLib.MarkupParseContext
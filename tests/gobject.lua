@@ -353,3 +353,41 @@ function gobject.signal_query()
    check(#query.param_types == 1)
    check(query.param_types[1] == GObject.Type.name(GObject.Type.PARAM))
 end
+
+function gobject.access_cache_invalidate()
+   local GObject = LuaGObject.GObject
+   local Derived = GObject.Object:derive('LuaGObjectTestAccessCache')
+   local Leaf = Derived:derive('LuaGObjectTestAccessCacheLeaf')
+   function Derived:greet() return 'derived' end
+   local obj = Leaf()
+   checkv(obj:greet(), 'derived', 'string')
+   checkv(obj:greet(), 'derived', 'string')
+
+   -- Redefinition of already existing member.
+   function Derived:greet() return 'redefined' end
+   checkv(obj:greet(), 'redefined', 'string')
+
+   -- New member shadowing the inherited one.
+   function Leaf:greet() return 'leaf' end
+   checkv(obj:greet(), 'leaf', 'string')
+   Leaf.greet = nil
+   checkv(obj:greet(), 'redefined', 'string')
+
+   -- New member of the parent shadowing member of GObject.Object.
+   check(obj:is_floating() == false)
+   function Derived:is_floating() return 'derived' end
+   checkv(obj:is_floating(), 'derived', 'string')
+
+   -- Keyword-translated symbols are revalidated under the real key.
+   Derived['end'] = function() return 'end' end
+   checkv(obj:_end(), 'end', 'string')
+   checkv(obj:_end(), 'end', 'string')
+   rawset(Derived, 'end', function() return 'redefined end' end)
+   checkv(obj:_end(), 'redefined end', 'string')
+   Leaf['end'] = function() return 'leaf end' end
+   checkv(obj:_end(), 'leaf end', 'string')
+
+   -- Unrelated members keep cached elements valid.
+   Leaf.unrelated = true
+   checkv(obj:greet(), 'redefined', 'string')
+end